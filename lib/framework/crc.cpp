@@ -86,6 +86,32 @@ uint32_t crcSumVector2i(uint32_t crc, const Vector2i *data, size_t dataLen)
 	return crc;
 }
 
+uint32_t hashU32(uint32_t hash, const uint32_t *data, size_t dataLen)
+{
+	// Four independent FNV-style lanes, so the main loop has no dependency between neighbouring words, and can be vectorised.
+	uint32_t lanes[4] = {hash ^ 0x811C9DC5, hash ^ 0x9E3779B9, hash ^ 0x85EBCA6B, hash ^ 0xC2B2AE35};
+	size_t i = 0;
+	for (; i + 4 <= dataLen; i += 4)
+	{
+		for (unsigned lane = 0; lane < 4; ++lane)
+		{
+			lanes[lane] = (lanes[lane] ^ data[i + lane]) * 0x01000193;
+		}
+	}
+	for (; i < dataLen; ++i)
+	{
+		lanes[i % 4] = (lanes[i % 4] ^ data[i]) * 0x01000193;
+	}
+
+	uint32_t ret = (uint32_t)dataLen;
+	for (unsigned lane = 0; lane < 4; ++lane)
+	{
+		ret = (ret ^ lanes[lane]) * 0x2C1B3C6D;
+		ret ^= ret >> 15;
+	}
+	return ret;
+}
+
 //================================================================================
 // MARK: - SHA256
 //================================================================================
@@ -29,6 +29,8 @@ uint32_t crcSum(uint32_t crc, const void *data, size_t dataLen);
 uint32_t crcSumU16(uint32_t crc, const uint16_t *data, size_t dataLen);
 uint32_t crcSumI16(uint32_t crc, const int16_t *data, size_t dataLen);
 uint32_t crcSumVector2i(uint32_t crc, const Vector2i *data, size_t dataLen);
+/// Fast, non-cryptographic hash of 32-bit words, not compatible with crcSum(). Gives the same result regardless of endianness.
+uint32_t hashU32(uint32_t hash, const uint32_t *data, size_t dataLen);
 
 struct Sha256
 {
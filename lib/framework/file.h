@@ -35,6 +35,22 @@ WZ_DECL_NONNULL(1) bool loadFile(const char *pFileName, char **ppFileData, UDWOR
 /** Save the data in the buffer into the given file */
 WZ_DECL_NONNULL(1) bool saveFile(const char *pFileName, const char *pFileData, UDWORD fileSize);
 
+/** Save the data under a temporary name, and only rename it to the given file once it is complete, so that an
+ *  interrupted write never leaves a truncated file behind. */
+WZ_DECL_NONNULL(1) bool saveFileAtomically(const char *pFileName, const char *pFileData, UDWORD fileSize);
+
+/** Whether the file exists, and is found in the write directory rather than in another part of the search path.
+ *  Mod and map archives are also in the search path, so files that only the game itself writes should be checked
+ *  with this before they are trusted. */
+WZ_DECL_NONNULL(1) bool isWriteDirFile(const char *pFileName);
+
+/** Rename a file in the write directory, replacing any file of the new name. */
+WZ_DECL_NONNULL(1, 2) bool renameWriteDirFile(const char *oldName, const char *newName);
+
+/** Trim a cache directory in the write directory: delete the files written more than maxAgeDays ago, then the
+ *  oldest ones until the rest fit in maxBytes. Leftover temporary files of interrupted writes are deleted too. */
+WZ_DECL_NONNULL(1) void pruneCacheDirectory(const char *dirName, uint64_t maxBytes, unsigned maxAgeDays);
+
 /** Load a file from disk into a fixed memory buffer. */
 WZ_DECL_NONNULL(1, 2) bool loadFileToBuffer(const char *pFileName, char *pFileBuffer, UDWORD bufferSize, UDWORD *pSize);
 
@@ -43,4 +59,20 @@ WZ_DECL_NONNULL(1, 2) bool loadFileToBufferNoError(const char *pFileName, char *
 
 WZ_DECL_NONNULL(1) Sha256 findHashOfFile(char const *realFileName);
 
+struct AssetCacheStats
+{
+	size_t hits = 0;     ///< Files loaded from the cache
+	size_t misses = 0;   ///< Archived files that had to be read (and decompressed) from the archive
+	size_t bytes = 0;    ///< Bytes currently cached
+	size_t entries = 0;  ///< Files currently cached
+	size_t limit = 0;    ///< Bytes the cache may use
+};
+
+/** Sets how much memory the cache of files loaded from archives may use. 0 (the default) disables it. */
+void setAssetCacheLimit(size_t bytes);
+void assetCacheClear();
+AssetCacheStats assetCacheStats();
+/** Whether loading the file would keep it in the cache: only files in archives (which are expensive to read) that are small enough are kept. */
+WZ_DECL_NONNULL(1) bool assetCacheAccepts(const char *pFileName, size_t fileSize);
+
 #endif // _file_h
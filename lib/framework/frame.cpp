@@ -34,6 +34,12 @@
 #include "frameresource.h"
 #include "input.h"
 
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 /************************************************************************************
  *
  *	Player globals
@@ -165,7 +171,7 @@ PHYSFS_file *openLoadFile(const char *fileName, bool hard_fail)
 
   If hard_fail is true, we will assert and report on failures.
 ***************************************************************************/
-static bool loadFile2(const char *pFileName, char **ppFileData, UDWORD *pFileSize, bool AllocateMem, bool hard_fail)
+static bool loadFileUncached(const char *pFileName, char **ppFileData, UDWORD *pFileSize, bool AllocateMem, bool hard_fail)
 {
 	if (WZ_PHYSFS_isDirectory(pFileName))
 	{
@@ -240,6 +246,148 @@ static bool loadFile2(const char *pFileName, char **ppFileData, UDWORD *pFileSiz
 	return true;
 }
 
+/***************************************************************************
+  Read-through cache of files loaded from archives, so that files read again
+  (on every level load, for example) are not decompressed again. Entries are
+  evicted least recently used first, once the cache grows past its limit.
+  Loose files are never cached, since they may be written to at any time.
+***************************************************************************/
+struct AssetCacheEntry
+{
+	std::vector<char> data;
+	PHYSFS_sint64 modtime;
+	std::list<std::string>::iterator lruPosition;
+};
+
+static std::mutex assetCacheMutex;
+static std::unordered_map<std::string, AssetCacheEntry> assetCache;  // Keyed by archive and file name
+static std::list<std::string> assetCacheLru;                        // Most recently used first
+static std::atomic<size_t> assetCacheLimit(0);  // Off unless configured, see setAssetCacheLimit()
+static AssetCacheStats assetCacheCounters;
+
+static void assetCacheEvict(size_t limit)
+{
+	while (assetCacheCounters.bytes > limit && !assetCacheLru.empty())
+	{
+		auto it = assetCache.find(assetCacheLru.back());
+		assetCacheCounters.bytes -= it->second.data.size();
+		assetCache.erase(it);
+		assetCacheLru.pop_back();
+	}
+	assetCacheCounters.entries = assetCache.size();
+}
+
+void setAssetCacheLimit(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(assetCacheMutex);
+	assetCacheLimit = bytes;
+	assetCacheEvict(assetCacheLimit);
+}
+
+void assetCacheClear()
+{
+	std::lock_guard<std::mutex> lock(assetCacheMutex);
+	assetCacheEvict(0);
+}
+
+AssetCacheStats assetCacheStats()
+{
+	std::lock_guard<std::mutex> lock(assetCacheMutex);
+	AssetCacheStats stats = assetCacheCounters;
+	stats.limit = assetCacheLimit;
+	return stats;
+}
+
+static bool isArchivePath(const char *realDir)
+{
+	size_t len = strlen(realDir);
+	return (len > 3 && strcasecmp(realDir + len - 3, ".wz") == 0) || (len > 4 && strcasecmp(realDir + len - 4, ".zip") == 0);
+}
+
+// Must be called with assetCacheMutex held
+static bool assetCacheFits(size_t fileSize)
+{
+	return fileSize <= assetCacheLimit / 4;  // Big files would only push everything else out.
+}
+
+bool assetCacheAccepts(const char *pFileName, size_t fileSize)
+{
+	const char *realDir = PHYSFS_getRealDir(pFileName);
+	if (realDir == nullptr || !isArchivePath(realDir))
+	{
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(assetCacheMutex);
+	return assetCacheFits(fileSize);
+}
+
+static bool loadFile2(const char *pFileName, char **ppFileData, UDWORD *pFileSize, bool AllocateMem, bool hard_fail)
+{
+	if (assetCacheLimit == 0)
+	{
+		return loadFileUncached(pFileName, ppFileData, pFileSize, AllocateMem, hard_fail);
+	}
+	const char *realDir = PHYSFS_getRealDir(pFileName);
+	PHYSFS_Stat metaData;
+	if (realDir == nullptr || !isArchivePath(realDir) || !PHYSFS_stat(pFileName, &metaData) || metaData.filetype != PHYSFS_FILETYPE_REGULAR)
+	{
+		return loadFileUncached(pFileName, ppFileData, pFileSize, AllocateMem, hard_fail);
+	}
+	std::string key = std::string(realDir) + '\0' + pFileName;
+
+	{
+		std::lock_guard<std::mutex> lock(assetCacheMutex);
+		auto it = assetCache.find(key);
+		if (it != assetCache.end() && it->second.modtime == metaData.modtime && static_cast<PHYSFS_sint64>(it->second.data.size()) == metaData.filesize)
+		{
+			std::vector<char> const &data = it->second.data;
+			if (AllocateMem)
+			{
+				*ppFileData = (char *)malloc(data.size() + 1);
+			}
+			else if (data.size() > *pFileSize)
+			{
+				debug(LOG_ERROR, "No room for file %s, buffer is too small! Got: %d Need: %zu", pFileName, *pFileSize, data.size());
+				assert(false);
+				return false;
+			}
+			memcpy(*ppFileData, data.data(), data.size());
+			*((*ppFileData) + data.size()) = 0;
+			*pFileSize = static_cast<UDWORD>(data.size());
+			assetCacheLru.splice(assetCacheLru.begin(), assetCacheLru, it->second.lruPosition);
+			++assetCacheCounters.hits;
+			return true;
+		}
+		++assetCacheCounters.misses;
+	}
+
+	if (!loadFileUncached(pFileName, ppFileData, pFileSize, AllocateMem, hard_fail))
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(assetCacheMutex);
+	if (!assetCacheFits(*pFileSize))
+	{
+		return true;
+	}
+	auto it = assetCache.find(key);
+	if (it != assetCache.end())
+	{
+		assetCacheCounters.bytes -= it->second.data.size();
+		assetCacheLru.erase(it->second.lruPosition);
+		assetCache.erase(it);
+	}
+	assetCacheLru.push_front(key);
+	AssetCacheEntry &entry = assetCache[key];
+	entry.data.assign(*ppFileData, *ppFileData + *pFileSize);
+	entry.modtime = metaData.modtime;
+	entry.lruPosition = assetCacheLru.begin();
+	assetCacheCounters.bytes += *pFileSize;
+	assetCacheEvict(assetCacheLimit);
+	return true;
+}
+
 PHYSFS_file *openSaveFile(const char *fileName)
 {
 	PHYSFS_file *fileHandle = PHYSFS_openWrite(fileName);
@@ -301,6 +449,108 @@ bool saveFile(const char *pFileName, const char *pFileData, UDWORD fileSize)
 	return true;
 }
 
+bool isWriteDirFile(const char *pFileName)
+{
+	const char *writeDir = PHYSFS_getWriteDir();
+	const char *realDir = PHYSFS_getRealDir(pFileName);
+	return writeDir != nullptr && realDir != nullptr && strcmp(realDir, writeDir) == 0;
+}
+
+bool renameWriteDirFile(const char *oldName, const char *newName)
+{
+	const char *writeDir = PHYSFS_getWriteDir();
+	ASSERT_OR_RETURN(false, writeDir != nullptr, "No write directory");
+	const std::string separator = PHYSFS_getDirSeparator();
+	auto realPath = [&](const char *name) {
+		std::string path = writeDir;
+		if (path.empty() || path.compare(path.size() - separator.size(), separator.size(), separator) != 0)
+		{
+			path += separator;
+		}
+		for (const char *c = name; *c != '\0'; ++c)
+		{
+			if (*c == '/')
+			{
+				path += separator;
+			}
+			else
+			{
+				path += *c;
+			}
+		}
+		return path;
+	};
+	const std::string oldPath = realPath(oldName), newPath = realPath(newName);
+#if defined(WZ_OS_WIN)
+	remove(newPath.c_str());  // rename() does not replace existing files on Windows
+#endif
+	if (rename(oldPath.c_str(), newPath.c_str()) != 0)
+	{
+		debug(LOG_ERROR, "Could not rename %s to %s: %s", oldName, newName, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+bool saveFileAtomically(const char *pFileName, const char *pFileData, UDWORD fileSize)
+{
+	const std::string tmpName = std::string(pFileName) + ".tmp";
+	if (!saveFile(tmpName.c_str(), pFileData, fileSize) || !renameWriteDirFile(tmpName.c_str(), pFileName))
+	{
+		PHYSFS_delete(tmpName.c_str());
+		return false;
+	}
+	return true;
+}
+
+void pruneCacheDirectory(const char *dirName, uint64_t maxBytes, unsigned maxAgeDays)
+{
+	struct CacheFile
+	{
+		std::string path;
+		PHYSFS_sint64 modTime;
+		PHYSFS_sint64 size;
+	};
+	std::vector<CacheFile> files;
+	const PHYSFS_sint64 oldest = (PHYSFS_sint64)time(nullptr) - (PHYSFS_sint64)maxAgeDays * 24 * 60 * 60;
+	size_t deleted = 0;
+
+	WZ_PHYSFS_enumerateFiles(dirName, [&](const char *file) -> bool {
+		std::string path = std::string(dirName) + "/" + file;
+		PHYSFS_sint64 modTime = WZ_PHYSFS_getLastModTime(path.c_str());
+		bool isTemporary = path.size() > 4 && path.compare(path.size() - 4, 4, ".tmp") == 0;
+		if (isTemporary || modTime < oldest)
+		{
+			deleted += PHYSFS_delete(path.c_str()) ? 1 : 0;
+			return true;
+		}
+		PHYSFS_file *handle = PHYSFS_openRead(path.c_str());
+		if (handle)
+		{
+			files.push_back(CacheFile{path, modTime, PHYSFS_fileLength(handle)});
+			PHYSFS_close(handle);
+		}
+		return true;
+	});
+
+	std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) {
+		return a.modTime > b.modTime;  // Newest first
+	});
+	uint64_t totalBytes = 0;
+	for (const CacheFile &file : files)
+	{
+		totalBytes += std::max<PHYSFS_sint64>(file.size, 0);
+		if (totalBytes > maxBytes)
+		{
+			deleted += PHYSFS_delete(file.path.c_str()) ? 1 : 0;
+		}
+	}
+	if (deleted > 0)
+	{
+		debug(LOG_WZ, "Pruned %zu files from %s", deleted, dirName);
+	}
+}
+
 bool loadFile(const char *pFileName, char **ppFileData, UDWORD *pFileSize)
 {
 	return loadFile2(pFileName, ppFileData, pFileSize, true, true);
@@ -30,6 +30,10 @@
 
 #include "file.h"
 #include "resly.h"
+#include "wzthreadpool.h"
+
+#include <chrono>
+#include <unordered_map>
 
 // Local prototypes
 static RES_TYPE *psResTypes = nullptr;
@@ -47,6 +51,15 @@ static void ResetResourceFile();
 // callback to resload screen.
 static RESLOAD_CALLBACK resLoadCallback = nullptr;
 
+// While collecting, resLoadFile() only notes which files a .wrf would load, so they can be read ahead of time.
+struct ResPrefetchFile
+{
+	std::string fileName;
+	bool buffered;  ///< Loaded through a RES_BUFFERLOAD, so the buffer can be handed over directly.
+};
+static std::vector<ResPrefetchFile> *resPrefetchCollecting = nullptr;
+static std::unordered_map<std::string, std::pair<char *, UDWORD>> resPrefetched;  ///< Buffers read ahead, by file name.
+
 
 /* next four used in HashPJW */
 #define	BITS_IN_int		32
@@ -181,24 +194,19 @@ void resSetBaseDir(const char *pResDir)
 }
 
 /* Parse the res file */
-bool resLoad(const char *pResFile, SDWORD blockID)
+static bool resParse(const char *pResFile)
 {
 	bool retval = true;
 	lexerinput_t input;
 
 	sstrcpy(aCurrResDir, aResDir);
 
-	// Note the block id number
-	resBlockID = blockID;
-
-	debug(LOG_WZ, "resLoad: loading [directory: %s] %s", WZ_PHYSFS_getRealDir_String(pResFile).c_str(), pResFile);
-
 	// Load the RES file; allocate memory for a wrf, and load it
 	input.type = LEXINPUT_PHYSFS;
 	input.input.physfsfile = openLoadFile(pResFile, true);
 	if (!input.input.physfsfile)
 	{
-		debug(LOG_FATAL, "Could not open file %s", pResFile);
+		debug(resPrefetchCollecting ? LOG_WZ : LOG_FATAL, "Could not open file %s", pResFile);
 		return false;
 	}
 
@@ -206,7 +214,7 @@ bool resLoad(const char *pResFile, SDWORD blockID)
 	res_set_extra(&input);
 	if (res_parse() != 0)
 	{
-		debug(LOG_FATAL, "Failed to parse %s", pResFile);
+		debug(resPrefetchCollecting ? LOG_WZ : LOG_FATAL, "Failed to parse %s", pResFile);
 		retval = false;
 	}
 
@@ -216,6 +224,103 @@ bool resLoad(const char *pResFile, SDWORD blockID)
 	return retval;
 }
 
+// Reads (and, for archives, inflates) the files the .wrf refers to on a thread pool, leaving only the
+// type-specific processing and registration to the main thread. Buffered files are handed over directly.
+// Files of types whose loaders read them with loadFile() are read ahead into the asset cache, if it would
+// keep them and as far as it has room for them. Other files are left to their loaders.
+static void resPrefetch(const char *pResFile)
+{
+	std::vector<ResPrefetchFile> files;
+	resPrefetchCollecting = &files;
+	bool ok = resParse(pResFile);
+	resPrefetchCollecting = nullptr;
+	if (!ok)
+	{
+		return;  // Reported again when loading for real.
+	}
+
+	std::vector<std::pair<char *, UDWORD>> buffers(files.size(), std::make_pair((char *)nullptr, (UDWORD)0));
+	size_t warmBudget = assetCacheStats().limit / 2;
+	std::vector<bool> warm(files.size(), false);
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		PHYSFS_Stat metaData;
+		if (!files[i].buffered && PHYSFS_stat(files[i].fileName.c_str(), &metaData) && metaData.filesize >= 0 && (size_t)metaData.filesize <= warmBudget
+		    && assetCacheAccepts(files[i].fileName.c_str(), (size_t)metaData.filesize))
+		{
+			warmBudget -= (size_t)metaData.filesize;
+			warm[i] = true;
+		}
+	}
+	WzThreadPool pool(WzThreadPool::defaultWorkerThreadCount());
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		if (!files[i].buffered && !warm[i])
+		{
+			continue;
+		}
+		pool.addJob([&files, &buffers, &warm, i]() {
+			char *pBuffer = nullptr;
+			UDWORD size = 0;
+			if (!PHYSFS_exists(files[i].fileName.c_str()) || !loadFile(files[i].fileName.c_str(), &pBuffer, &size))
+			{
+				return;
+			}
+			if (warm[i])
+			{
+				free(pBuffer);  // Only needed in the asset cache.
+				return;
+			}
+			buffers[i] = std::make_pair(pBuffer, size);
+		});
+	}
+	pool.waitForAll();
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		if (buffers[i].first == nullptr)
+		{
+			continue;
+		}
+		auto inserted = resPrefetched.insert(std::make_pair(files[i].fileName, buffers[i]));
+		if (!inserted.second)
+		{
+			free(buffers[i].first);  // Listed twice.
+		}
+	}
+}
+
+static void resPrefetchRelease()
+{
+	for (auto &prefetched : resPrefetched)
+	{
+		free(prefetched.second.first);
+	}
+	resPrefetched.clear();
+}
+
+bool resLoad(const char *pResFile, SDWORD blockID)
+{
+	// Note the block id number
+	resBlockID = blockID;
+
+	debug(LOG_WZ, "resLoad: loading [directory: %s] %s", WZ_PHYSFS_getRealDir_String(pResFile).c_str(), pResFile);
+
+	auto start = std::chrono::steady_clock::now();
+	resPrefetch(pResFile);
+	auto prefetched = std::chrono::steady_clock::now();
+	size_t numPrefetched = resPrefetched.size();
+
+	bool retval = resParse(pResFile);
+	resPrefetchRelease();
+
+	auto loaded = std::chrono::steady_clock::now();
+	debug(LOG_WZ, "resLoad: %s read ahead in %u ms (%zu files buffered), processed in %u ms", pResFile,
+	      (unsigned)std::chrono::duration_cast<std::chrono::milliseconds>(prefetched - start).count(), numPrefetched,
+	      (unsigned)std::chrono::duration_cast<std::chrono::milliseconds>(loaded - prefetched).count());
+
+	return retval;
+}
+
 
 /* Allocate a RES_TYPE structure */
 static RES_TYPE *resAlloc(const char *pType)
@@ -248,6 +353,7 @@ bool resAddBufferLoad(const char *pType, RES_BUFFERLOAD buffLoad, RES_FREE relea
 	psT->buffLoad = buffLoad;
 	psT->fileLoad = nullptr;
 	psT->release = release;
+	psT->readAhead = false;
 
 	psT->psNext = psResTypes;
 	psResTypes = psT;
@@ -257,13 +363,14 @@ bool resAddBufferLoad(const char *pType, RES_BUFFERLOAD buffLoad, RES_FREE relea
 
 
 /* Add a file name load function for a file type */
-bool resAddFileLoad(const char *pType, RES_FILELOAD fileLoad, RES_FREE release)
+bool resAddFileLoad(const char *pType, RES_FILELOAD fileLoad, RES_FREE release, bool readAhead)
 {
 	RES_TYPE	*psT = resAlloc(pType);
 
 	psT->buffLoad = nullptr;
 	psT->fileLoad = fileLoad;
 	psT->release = release;
+	psT->readAhead = readAhead && fileLoad != nullptr;
 
 	psT->psNext = psResTypes;
 	psResTypes = psT;
@@ -366,8 +473,15 @@ static bool RetreiveResourceFile(char *ResourceName, RESOURCEFILE **NewResource)
 	ResData = &LoadedResourceFiles[ResID];
 	*NewResource = ResData;
 
+	auto prefetched = resPrefetched.find(ResourceName);
+	if (prefetched != resPrefetched.end())
+	{
+		pBuffer = prefetched->second.first;
+		size = prefetched->second.second;
+		resPrefetched.erase(prefetched);
+	}
 	// This is needed for files that do not fit in the WDG cache ... (VAB file for example)
-	if (!loadFile(ResourceName, &pBuffer, &size))
+	else if (!loadFile(ResourceName, &pBuffer, &size))
 	{
 		return false;
 	}
@@ -514,6 +628,15 @@ bool resLoadFile(const char *pType, const char *pFile)
 
 	makeLocaleFile(aFileName, sizeof(aFileName));  // check for translated file
 
+	if (resPrefetchCollecting != nullptr)
+	{
+		if (psT->buffLoad || psT->readAhead)
+		{
+			resPrefetchCollecting->push_back(ResPrefetchFile{aFileName, psT->buffLoad != nullptr});
+		}
+		return true;
+	}
+
 	SetLastResourceFilename(pFile); // Save the filename in case any routines need it
 
 	// load the resource
@@ -71,6 +71,7 @@ struct RES_TYPE
 	UDWORD	HashedType;				// hashed version of the name of the id - // a null hashedtype indicates end of list
 
 	RES_FILELOAD	fileLoad;		// This isn't really used any more ?
+	bool			readAhead;		// fileLoad reads the file with loadFile(), so it is worth reading ahead into the asset cache
 	RES_TYPE       *psNext;
 };
 
@@ -106,8 +107,10 @@ void resReleaseAllData();
 /** Add a buffer load and release function for a file type. */
 WZ_DECL_NONNULL(1) bool resAddBufferLoad(const char *pType, RES_BUFFERLOAD buffLoad, RES_FREE release);
 
-/** Add a file name load and release function for a file type. */
-WZ_DECL_NONNULL(1) bool resAddFileLoad(const char *pType, RES_FILELOAD fileLoad, RES_FREE release);
+/** Add a file name load and release function for a file type.
+ *  Set readAhead if fileLoad reads the file with loadFile() (directly, or through WzConfig), so that resLoad() can read
+ *  it ahead into the asset cache. Loaders that open the file themselves would only read it a second time. */
+WZ_DECL_NONNULL(1) bool resAddFileLoad(const char *pType, RES_FILELOAD fileLoad, RES_FREE release, bool readAhead);
 
 /** Call the load function for a file. */
 WZ_DECL_NONNULL(1, 2) bool resLoadFile(const char *pType, const char *pFile);
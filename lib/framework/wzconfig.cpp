@@ -27,20 +27,194 @@
 #include <physfs.h>
 #include "file.h"
 #include <sstream>
+#include <iomanip>
+#include <streambuf>
 #include "physfs_ext.h"
+#include "wzthreadpool.h"
+#include <unordered_map>
+
+#define BINARY_JSON_MAGIC "WZbj"
+#define BINARY_JSON_VERSION 1
+
+/// Buffers writes to a PHYSFS file, so that large files can be streamed out without being built in memory first.
+class PhysfsOutputStreamBuf : public std::streambuf
+{
+public:
+	explicit PhysfsOutputStreamBuf(PHYSFS_file *file) : file(file), buffer(64 * 1024)
+	{
+		setp(buffer.data(), buffer.data() + buffer.size());
+	}
+
+	bool failed() const
+	{
+		return writeFailed;
+	}
+
+protected:
+	int_type overflow(int_type c) override
+	{
+		if (!flushBuffer())
+		{
+			return traits_type::eof();
+		}
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync() override
+	{
+		return flushBuffer() ? 0 : -1;
+	}
+
+private:
+	bool flushBuffer()
+	{
+		PHYSFS_uint32 size = static_cast<PHYSFS_uint32>(pptr() - pbase());
+		if (size != 0 && WZ_PHYSFS_writeBytes(file, pbase(), size) != size)
+		{
+			writeFailed = true;
+		}
+		setp(buffer.data(), buffer.data() + buffer.size());
+		return !writeFailed;
+	}
+
+	PHYSFS_file *file;
+	std::vector<char> buffer;
+	bool writeFailed = false;
+};
+
+bool saveJsonFile(const char *fileName, const nlohmann::json &root, JsonFileFormat format)
+{
+	PHYSFS_file *file = openSaveFile(fileName);
+	if (!file)
+	{
+		ASSERT(false, "Couldn't save file %s (%s)?", fileName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+
+	PhysfsOutputStreamBuf streamBuf(file);
+	std::ostream stream(&streamBuf);
+	if (format == JSON_FILE_BINARY)
+	{
+		// Object keys are stored by name in CBOR too, so readers can skip fields they don't know, just like with text.
+		char header[8] = {BINARY_JSON_MAGIC[0], BINARY_JSON_MAGIC[1], BINARY_JSON_MAGIC[2], BINARY_JSON_MAGIC[3], 0, 0, 0, BINARY_JSON_VERSION};
+		stream.write(header, sizeof(header));
+		nlohmann::json::to_cbor(root, stream);
+	}
+	else
+	{
+		stream << std::setw(4) << root << std::endl;
+	}
+	stream.flush();
+	bool ok = !streamBuf.failed() && stream.good();
+	if (!ok)
+	{
+		debug(LOG_ERROR, "%s could not write: %s", fileName, WZ_PHYSFS_getLastError());
+	}
+	if (!PHYSFS_close(file))
+	{
+		debug(LOG_ERROR, "Error closing %s: %s", fileName, WZ_PHYSFS_getLastError());
+		ok = false;
+	}
+	return ok;
+}
+
+static thread_local std::vector<DeferredJsonFile> *deferredJsonFiles = nullptr;
+
+bool saveJsonFile(const char *fileName, nlohmann::json &&root, JsonFileFormat format)
+{
+	if (deferredJsonFiles != nullptr)
+	{
+		deferredJsonFiles->push_back(DeferredJsonFile{fileName, std::move(root), format});
+		return true;
+	}
+	return saveJsonFile(fileName, root, format);
+}
+
+void saveJsonFilesDeferredBegin()
+{
+	ASSERT_OR_RETURN(, deferredJsonFiles == nullptr, "Already deferring");
+	deferredJsonFiles = new std::vector<DeferredJsonFile>();
+}
+
+std::vector<DeferredJsonFile> saveJsonFilesDeferredEnd()
+{
+	std::vector<DeferredJsonFile> files;
+	if (deferredJsonFiles != nullptr)
+	{
+		files = std::move(*deferredJsonFiles);
+		delete deferredJsonFiles;
+		deferredJsonFiles = nullptr;
+	}
+	return files;
+}
+
+nlohmann::json parseJsonFile(const char *data, size_t size)
+{
+	if (size >= 8 && memcmp(data, BINARY_JSON_MAGIC, 4) == 0)
+	{
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+		uint32_t version = (uint32_t)bytes[4] << 24 | (uint32_t)bytes[5] << 16 | (uint32_t)bytes[6] << 8 | bytes[7];
+		if (version > BINARY_JSON_VERSION)
+		{
+			debug(LOG_ERROR, "Binary JSON version %u is newer than this build supports (%u)", version, BINARY_JSON_VERSION);
+			return nlohmann::json();
+		}
+		return nlohmann::json::from_cbor(bytes + 8, bytes + size);
+	}
+	return nlohmann::json::parse(data, data + size);
+}
+
+static thread_local std::unordered_map<std::string, nlohmann::json> preparsedJsonFiles;
+
+void preparseJsonFiles(const std::vector<std::string> &fileNames, WzThreadPool &pool)
+{
+	// Each job only touches its own slot, so no locking is needed until the results are collected below.
+	std::vector<nlohmann::json> roots(fileNames.size());
+	for (size_t i = 0; i < fileNames.size(); ++i)
+	{
+		pool.addJob([&fileNames, &roots, i]() {
+			const char *fileName = fileNames[i].c_str();
+			UDWORD size = 0;
+			char *data = nullptr;
+			if (!PHYSFS_exists(fileName) || !loadFile(fileName, &data, &size))
+			{
+				return;
+			}
+			try {
+				roots[i] = parseJsonFile(data, size);
+			}
+			catch (...) {
+				roots[i] = nlohmann::json();  // Parsed again (and reported) when opened.
+			}
+			free(data);
+		});
+	}
+	pool.waitForAll();
+	for (size_t i = 0; i < fileNames.size(); ++i)
+	{
+		if (roots[i].is_object())
+		{
+			preparsedJsonFiles[fileNames[i]] = std::move(roots[i]);
+		}
+	}
+}
+
+void clearPreparsedJsonFiles()
+{
+	preparsedJsonFiles.clear();
+}
 
 WzConfig::~WzConfig()
 {
 	if (mWarning == ReadAndWrite)
 	{
 		ASSERT(mObjStack.empty(), "Some json groups have not been closed, stack size %zu.", mObjStack.size());
-		std::ostringstream stream;
-		stream << mRoot.dump(4) << std::endl;
-		std::string jsonString = stream.str();
-#if SIZE_MAX >= UDWORD_MAX
-		ASSERT(jsonString.size() <= static_cast<size_t>(std::numeric_limits<UDWORD>::max()), "jsonString.size (%zu) exceeds UDWORD::max", jsonString.size());
-#endif
-		saveFile(mFilename.toUtf8().c_str(), jsonString.c_str(), static_cast<UDWORD>(jsonString.size()));
+		saveJsonFile(mFilename.toUtf8().c_str(), std::move(mRoot), mFormat);
 	}
 	debug(LOG_SAVE, "%s %s", mWarning == ReadAndWrite? "Saving" : "Closing", mFilename.toUtf8().c_str());
 }
@@ -95,24 +269,33 @@ WzConfig::WzConfig(const WzString &name, WzConfig::warning warning)
 			return;
 		}
 	}
-	if (!loadFile(name.toUtf8().c_str(), &data, &size))
+	auto preparsed = warning != ReadAndWrite ? preparsedJsonFiles.find(name.toUtf8()) : preparsedJsonFiles.end();
+	if (preparsed != preparsedJsonFiles.end())
 	{
-		debug(LOG_FATAL, "Could not open \"%s\"", name.toUtf8().c_str());
+		mRoot = std::move(preparsed->second);
+		preparsedJsonFiles.erase(preparsed);
 	}
+	else
+	{
+		if (!loadFile(name.toUtf8().c_str(), &data, &size))
+		{
+			debug(LOG_FATAL, "Could not open \"%s\"", name.toUtf8().c_str());
+		}
 
-	try {
-		mRoot = nlohmann::json::parse(data, data + size);
-	}
-	catch (const std::exception &e) {
-		ASSERT(false, "JSON document from %s is invalid: %s", name.toUtf8().c_str(), e.what());
-	}
-	catch (...) {
-		debug(LOG_FATAL, "Unexpected exception parsing JSON %s", name.toUtf8().c_str());
+		try {
+			mRoot = parseJsonFile(data, size);
+		}
+		catch (const std::exception &e) {
+			ASSERT(false, "JSON document from %s is invalid: %s", name.toUtf8().c_str(), e.what());
+		}
+		catch (...) {
+			debug(LOG_FATAL, "Unexpected exception parsing JSON %s", name.toUtf8().c_str());
+		}
+		ASSERT(!mRoot.is_null(), "JSON document from %s is null", name.toUtf8().c_str());
+		ASSERT(mRoot.is_object(), "JSON document from %s is not an object. Read: \n%s", name.toUtf8().c_str(), data);
+		free(data);
 	}
 	pCurrentObj = &mRoot;
-	ASSERT(!mRoot.is_null(), "JSON document from %s is null", name.toUtf8().c_str());
-	ASSERT(mRoot.is_object(), "JSON document from %s is not an object. Read: \n%s", name.toUtf8().c_str(), data);
-	free(data);
 	WZ_PHYSFS_enumerateFiles("diffs", [&](const char *i) -> bool {
 		std::string str(std::string("diffs/") + i + std::string("/") + name.toUtf8().c_str());
 		if (!PHYSFS_exists(str.c_str()))
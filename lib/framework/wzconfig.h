@@ -92,6 +92,36 @@ private:
 	nlohmann::json mObj;
 };
 
+/// Format used when writing a JSON file. Both are read transparently.
+enum JsonFileFormat
+{
+	JSON_FILE_TEXT,    ///< Indented JSON, for modders and debugging.
+	JSON_FILE_BINARY,  ///< Versioned header followed by CBOR. Smaller, and faster to write and parse.
+};
+
+/// Writes root to fileName, streaming it to the file rather than building the whole file in memory first.
+bool saveJsonFile(const char *fileName, const nlohmann::json &root, JsonFileFormat format = JSON_FILE_TEXT);
+/// Same, but takes ownership of root, so it can be queued without copying if deferring.
+bool saveJsonFile(const char *fileName, nlohmann::json &&root, JsonFileFormat format = JSON_FILE_TEXT);
+
+struct DeferredJsonFile
+{
+	std::string fileName;
+	nlohmann::json root;
+	JsonFileFormat format;
+};
+void saveJsonFilesDeferredBegin();                        ///< Until saveJsonFilesDeferredEnd(), saveJsonFile() calls on this thread only queue the files, instead of writing them.
+std::vector<DeferredJsonFile> saveJsonFilesDeferredEnd(); ///< Stops deferring, and returns the queued files, which can then be written with saveJsonFile() on any thread.
+/// Parses the contents of a file written by saveJsonFile, in either format. Throws like nlohmann::json::parse on bad input.
+nlohmann::json parseJsonFile(const char *data, size_t size);
+
+class WzThreadPool;
+/// Loads and parses fileNames concurrently on pool, and keeps the results for this thread. A WzConfig later opened
+/// read-only on this thread for one of these files takes the already parsed document instead of parsing it again.
+/// Files that are missing or fail to parse are skipped, so opening them reports errors as usual.
+void preparseJsonFiles(const std::vector<std::string> &fileNames, WzThreadPool &pool);
+void clearPreparsedJsonFiles(); ///< Drops any preparsed documents that were not used.
+
 class WzConfig
 {
 public:
@@ -108,6 +138,7 @@ private:
 	WzString mFilename;
 	bool mStatus;
 	warning mWarning;
+	JsonFileFormat mFormat = JSON_FILE_TEXT;
 
 public:
 	WzConfig(const WzString &name, WzConfig::warning warning);
@@ -149,6 +180,12 @@ public:
 		return mWarning == ReadAndWrite && mStatus;
 	}
 
+	/// Selects the format the file is written in, when done. The default is JSON_FILE_TEXT.
+	void setFileFormat(JsonFileFormat format)
+	{
+		mFormat = format;
+	}
+
 	void setValue(const WzString &key, const nlohmann::json &value);
 	void set(const WzString &key, const nlohmann::json &value);
 
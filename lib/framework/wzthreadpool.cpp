@@ -0,0 +1,139 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2021  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "frame.h"
+#include "wzthreadpool.h"
+
+WzThreadPool::WzThreadPool(unsigned int numWorkerThreads)
+{
+	mutex = wzMutexCreate();
+	jobSemaphore = wzSemaphoreCreate(0);
+	allDoneSemaphore = wzSemaphoreCreate(0);
+	for (unsigned int i = 0; i < numWorkerThreads; ++i)
+	{
+		WZ_THREAD *thread = wzThreadCreate(workerThreadFunc, this);
+		ASSERT_OR_RETURN(, thread != nullptr, "Failed to create worker thread %u", i);
+		wzThreadStart(thread);
+		workerThreads.push_back(thread);
+	}
+}
+
+WzThreadPool::~WzThreadPool()
+{
+	waitForAll();
+
+	wzMutexLock(mutex);
+	quit = true;
+	wzMutexUnlock(mutex);
+	for (size_t i = 0; i < workerThreads.size(); ++i)
+	{
+		wzSemaphorePost(jobSemaphore);  // Wake up every thread, so it notices it should quit.
+	}
+	for (WZ_THREAD *thread : workerThreads)
+	{
+		wzThreadJoin(thread);
+	}
+	workerThreads.clear();
+
+	wzSemaphoreDestroy(allDoneSemaphore);
+	wzSemaphoreDestroy(jobSemaphore);
+	wzMutexDestroy(mutex);
+}
+
+unsigned int WzThreadPool::defaultWorkerThreadCount()
+{
+	unsigned int numCPUs = wzGetLogicalCPUCount();
+	return (numCPUs > 1) ? numCPUs - 1 : 0;
+}
+
+void WzThreadPool::addJob(std::function<void ()> job)
+{
+	wzMutexLock(mutex);
+	jobs.push_back(std::move(job));
+	++unfinishedJobs;
+	wzMutexUnlock(mutex);
+	wzSemaphorePost(jobSemaphore);
+}
+
+// Must be called with the mutex held
+void WzThreadPool::finishedJob()
+{
+	--unfinishedJobs;
+	if (unfinishedJobs == 0 && waitingForAll)
+	{
+		waitingForAll = false;
+		wzSemaphorePost(allDoneSemaphore);
+	}
+}
+
+void WzThreadPool::waitForAll()
+{
+	wzMutexLock(mutex);
+	while (!jobs.empty())
+	{
+		// Rather than sleeping, run queued jobs on this thread too.
+		std::function<void ()> job = std::move(jobs.front());
+		jobs.pop_front();
+		wzMutexUnlock(mutex);
+		job();
+		wzMutexLock(mutex);
+		--unfinishedJobs;
+	}
+	if (unfinishedJobs == 0)
+	{
+		wzMutexUnlock(mutex);
+		return;
+	}
+	// Some jobs are still running on worker threads - the last one to finish wakes us up.
+	waitingForAll = true;
+	wzMutexUnlock(mutex);
+	wzSemaphoreWait(allDoneSemaphore);
+}
+
+/** This runs in a separate thread */
+int WzThreadPool::workerThreadFunc(void *data)
+{
+	WzThreadPool *pool = static_cast<WzThreadPool *>(data);
+	while (true)
+	{
+		wzSemaphoreWait(pool->jobSemaphore);  // Go to sleep until needed.
+		wzMutexLock(pool->mutex);
+		if (pool->quit)
+		{
+			wzMutexUnlock(pool->mutex);
+			break;
+		}
+		if (pool->jobs.empty())
+		{
+			// The job this wakeup was meant for was already taken by the thread in waitForAll().
+			wzMutexUnlock(pool->mutex);
+			continue;
+		}
+		std::function<void ()> job = std::move(pool->jobs.front());
+		pool->jobs.pop_front();
+		wzMutexUnlock(pool->mutex);
+
+		job();
+
+		wzMutexLock(pool->mutex);
+		pool->finishedJob();
+		wzMutexUnlock(pool->mutex);
+	}
+	return 0;
+}
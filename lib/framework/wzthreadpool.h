@@ -0,0 +1,67 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2021  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __INCLUDED_LIB_FRAMEWORK_WZTHREADPOOL_H__
+#define __INCLUDED_LIB_FRAMEWORK_WZTHREADPOOL_H__
+
+#include "wzapp.h"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+/// A fixed-size pool of worker threads that runs batches of independent jobs.
+///
+/// Jobs are started in the order they were added, but may run (and finish) concurrently.
+/// The thread that calls waitForAll() helps out with queued jobs instead of just sleeping,
+/// so a pool with zero worker threads simply runs every job on the calling thread.
+class WzThreadPool
+{
+public:
+	explicit WzThreadPool(unsigned int numWorkerThreads);
+	~WzThreadPool();
+
+	WzThreadPool(const WzThreadPool&) = delete;
+	WzThreadPool& operator=(const WzThreadPool&) = delete;
+
+	void addJob(std::function<void ()> job);
+
+	/// Returns once every job added so far has finished.
+	void waitForAll();
+
+	size_t numWorkerThreads() const { return workerThreads.size(); }
+
+	/// A sensible number of worker threads for CPU-bound jobs (one less than the number of logical CPUs, since the caller helps out)
+	static unsigned int defaultWorkerThreadCount();
+
+private:
+	static int workerThreadFunc(void *data);
+	void finishedJob();
+
+	std::vector<WZ_THREAD *> workerThreads;
+	WZ_MUTEX *mutex = nullptr;
+	WZ_SEMAPHORE *jobSemaphore = nullptr;
+	WZ_SEMAPHORE *allDoneSemaphore = nullptr;
+	std::deque<std::function<void ()>> jobs;
+	size_t unfinishedJobs = 0;
+	bool waitingForAll = false;
+	bool quit = false;
+};
+
+#endif // __INCLUDED_LIB_FRAMEWORK_WZTHREADPOOL_H__
@@ -63,6 +63,10 @@ static uint16_t discreteChosenLatency = GAME_TICKS_PER_UPDATE;
 static uint16_t wantedLatency = GAME_TICKS_PER_UPDATE;
 static uint16_t wantedLatencies[MAX_PLAYERS];
 
+/// Lower bound, in milliseconds, of each bucket of the tick wait histogram.
+static const unsigned waitBucketMin[GAME_TIME_WAIT_BUCKETS] = {0, 1, 5, 10, 20, 50, 100, 200, 500, 1000};
+static uint32_t waitHistogram[GAME_TIME_WAIT_BUCKETS];
+
 static void updateLatency(void);
 
 static std::string listToString(char const *format, char const *separator, uint32_t const *begin, uint32_t const *end)
@@ -110,6 +114,7 @@ void gameTimeInit(void)
 	{
 		wantedLatencies[player] = 0;
 	}
+	std::fill(waitHistogram, waitHistogram + GAME_TIME_WAIT_BUCKETS, 0);
 
 	// Don't let syncDebug from previous games cause a desynch dump at gameTime 102.
 	resetSyncDebug();
@@ -345,15 +350,54 @@ static void updateLatency()
 		debug(LOG_SYNC, "Adjusting latency %d -> %d", prevDiscreteChosenLatency, discreteChosenLatency);
 	}
 
+	// Record how long this tick had to wait for the others.
+	uint32_t waited = updateWantedTime != 0 && updateReadyTime > updateWantedTime ? updateReadyTime - updateWantedTime : 0;
+	unsigned bucket = GAME_TIME_WAIT_BUCKETS - 1;
+	while (waited < waitBucketMin[bucket])
+	{
+		--bucket;
+	}
+	++waitHistogram[bucket];
+
 	// We want the chosen latency to increase by how much our update was delayed waiting for others, or to decrease by how long after we got the messages from others that it was time to tick. Plus a tiny 10ms buffer.
+	// But never ask for less than the network needs according to the pings and their jitter, so that a ping spike is covered before anyone has to wait for it.
 	// We will send this number to others.
-	wantedLatency = static_cast<uint16_t>(clip<int>((int)(discreteChosenLatency + updateReadyTime - updateWantedTime + 10), 0, UINT16_MAX));
+	int measuredLatency = discreteChosenLatency + updateReadyTime - updateWantedTime + 10;
+	int networkLatency = networkInputDelay() + 10;
+	wantedLatency = static_cast<uint16_t>(clip<int>(std::max(measuredLatency, networkLatency), 0, UINT16_MAX));
 
 	// Reset the times, ready to be set again.
 	updateReadyTime = 0;
 	updateWantedTime = 0;
 }
 
+uint16_t gameTimeInputDelay()
+{
+	return discreteChosenLatency;
+}
+
+uint32_t gameTimeWaitHistogram(unsigned bucket)
+{
+	ASSERT_OR_RETURN(0, bucket < GAME_TIME_WAIT_BUCKETS, "Bad bucket %u", bucket);
+	return waitHistogram[bucket];
+}
+
+unsigned gameTimeWaitBucketMin(unsigned bucket)
+{
+	ASSERT_OR_RETURN(0, bucket < GAME_TIME_WAIT_BUCKETS, "Bad bucket %u", bucket);
+	return waitBucketMin[bucket];
+}
+
+std::string gameTimeWaitHistogramString()
+{
+	std::string ret;
+	for (unsigned bucket = 0; bucket < GAME_TIME_WAIT_BUCKETS; ++bucket)
+	{
+		ret += astringf("%s%ums:%u", bucket != 0 ? " " : "", waitBucketMin[bucket], waitHistogram[bucket]);
+	}
+	return ret;
+}
+
 void sendPlayerGameTime()
 {
 	unsigned player;
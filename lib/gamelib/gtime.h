@@ -27,6 +27,8 @@
 #include "lib/framework/vector.h"
 #include "lib/framework/rational.h"
 
+#include <string>
+
 
 struct NETQUEUE;
 
@@ -194,4 +196,10 @@ void recvPlayerGameTime(NETQUEUE queue);                  ///< Processes a GAME_
 bool checkPlayerGameTime(unsigned player);                ///< Checks that we are not waiting for a GAME_GAME_TIME message from this player. (player can be NET_ALL_PLAYERS.)
 void setPlayerGameTime(unsigned player, uint32_t time);   ///< Sets the player's time.
 
+#define GAME_TIME_WAIT_BUCKETS 10
+uint16_t gameTimeInputDelay();                            ///< The latency that all players currently agree on, in milliseconds.
+uint32_t gameTimeWaitHistogram(unsigned bucket);          ///< Number of ticks since gameTimeInit() that waited at least gameTimeWaitBucketMin(bucket) milliseconds (but less than the next bucket) for other players.
+unsigned gameTimeWaitBucketMin(unsigned bucket);
+std::string gameTimeWaitHistogramString();                ///< The wait histogram as "0ms:1234 1ms:56 5ms:7 ...", for logs.
+
 #endif
@@ -41,10 +41,12 @@
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <unordered_map>
 #include <sodium.h>
 
 #include "netplay.h"
 #include "netlog.h"
+#include "netreplay.h"
 #include "netsocket.h"
 
 #include <miniupnpc/miniwget.h>
@@ -84,6 +86,9 @@
 char masterserver_name[255] = {'\0'};
 static unsigned int masterserver_port = 0, gameserver_port = 0;
 static bool bJoinPrefTryIPv6First = true;
+static int compressionLevel = 6;
+static SocketCompressionStrategy compressionStrategy = SOCKET_COMPRESSION_DEFAULT;
+static bool bAdaptiveCompression = false;
 
 // This is for command line argument override
 // Disables port saving and reading from/to config
@@ -1488,6 +1493,10 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 		ASSERT_OR_RETURN(false, false, "Wrong queue type.");
 	}
 
+	// Serialised at most once per message, even when broadcasting. writeAll() copies (or compresses) the data
+	// into each socket's own buffer before returning, so every recipient can be handed the same bytes.
+	std::vector<uint8_t> rawData;
+
 	if (NetPlay.isHost)
 	{
 		int firstPlayer = player == NET_ALL_PLAYERS ? 0                         : player;
@@ -1497,11 +1506,14 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 			// We are the host, send directly to player.
 			if (sockets[player] != nullptr && player != queue.exclude)
 			{
-				uint8_t *rawData = message->rawDataDup();
-				ssize_t rawLen   = message->rawLen();
+				if (rawData.empty())
+				{
+					rawData.reserve(message->rawLen());
+					message->rawDataAppendToVector(rawData);
+				}
+				ssize_t rawLen   = rawData.size();
 				size_t compressedRawLen;
-				result = writeAll(sockets[player], rawData, rawLen, &compressedRawLen);
-				delete[] rawData;  // Done with the data.
+				result = writeAll(sockets[player], rawData.data(), rawLen, &compressedRawLen);
 
 				if (result == rawLen)
 				{
@@ -1528,11 +1540,11 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 		// We are a client, send directly to player, who happens to be the host.
 		if (bsocket)
 		{
-			uint8_t *rawData = message->rawDataDup();
-			ssize_t rawLen   = message->rawLen();
+			rawData.reserve(message->rawLen());
+			message->rawDataAppendToVector(rawData);
+			ssize_t rawLen   = rawData.size();
 			size_t compressedRawLen;
-			result = writeAll(bsocket, rawData, rawLen, &compressedRawLen);
-			delete[] rawData;  // Done with the data.
+			result = writeAll(bsocket, rawData.data(), rawLen, &compressedRawLen);
 
 			if (result == rawLen)
 			{
@@ -2101,10 +2113,16 @@ bool NETrecvGame(NETQUEUE *queue, uint8_t *type)
 		{
 			if (!NETisMessageReady(*queue))
 			{
+				if (NETreplayLoadNetMessage())
+				{
+					continue;  // Took the next message from the replay, which is probably from this player.
+				}
 				return false;  // Still waiting for messages from this player, and all players should process messages in the same order. Will have to freeze the game while waiting.
 			}
 
-			*type = NETgetMessage(*queue)->type;
+			NetMessage const *message = NETgetMessage(*queue);
+			*type = message->type;
+			NETreplaySaveNetMessage(*message, current);
 
 			if (*type == GAME_GAME_TIME)
 			{
@@ -3857,6 +3875,104 @@ bool NETgetJoinPreferenceIPv6()
 	return bJoinPrefTryIPv6First;
 }
 
+static const char *const compressionStrategyNames[] = {"default", "filtered", "huffman", "rle"};
+
+/*!
+ * Set the zlib level used to compress game traffic we send
+ * \param level 0 (no compression) to 9 (best compression)
+ */
+void NETsetCompressionLevel(int level)
+{
+	if (level < 0 || level > 9)
+	{
+		debug(LOG_ERROR, "Invalid compression level: %d", level);
+		return;
+	}
+	compressionLevel = level;
+	socketSetCompressionOptions(compressionLevel, compressionStrategy, bAdaptiveCompression);
+}
+
+int NETgetCompressionLevel()
+{
+	return compressionLevel;
+}
+
+/*!
+ * Set the zlib strategy used to compress game traffic we send
+ * \param strategy One of "default", "filtered", "huffman" or "rle"
+ */
+void NETsetCompressionStrategy(const std::string &strategy)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(compressionStrategyNames); ++i)
+	{
+		if (strategy == compressionStrategyNames[i])
+		{
+			compressionStrategy = static_cast<SocketCompressionStrategy>(i);
+			socketSetCompressionOptions(compressionLevel, compressionStrategy, bAdaptiveCompression);
+			return;
+		}
+	}
+	debug(LOG_ERROR, "Invalid compression strategy: %s", strategy.c_str());
+}
+
+std::string NETgetCompressionStrategy()
+{
+	return compressionStrategyNames[compressionStrategy];
+}
+
+/*!
+ * Set whether connections may lower their compression level while compressing takes too long
+ */
+void NETsetAdaptiveCompression(bool adaptive)
+{
+	bAdaptiveCompression = adaptive;
+	socketSetCompressionOptions(compressionLevel, compressionStrategy, bAdaptiveCompression);
+}
+
+bool NETgetAdaptiveCompression()
+{
+	return bAdaptiveCompression;
+}
+
+/**
+ * Sums up the compression statistics of all our connections. The level is the lowest level any of them currently uses.
+ * @return false if there are no compressed connections.
+ */
+bool NETgetCompressionStats(SocketCompressionStats &total)
+{
+	total = SocketCompressionStats();
+	total.level = compressionLevel;
+	bool any = false;
+	auto addSocket = [&](Socket const *sock) {
+		SocketCompressionStats stats;
+		if (sock == nullptr || !socketGetCompressionStats(sock, &stats))
+		{
+			return;
+		}
+		total.uncompressedBytes += stats.uncompressedBytes;
+		total.compressedBytes += stats.compressedBytes;
+		total.deflateMicroseconds += stats.deflateMicroseconds;
+		total.level = std::min(total.level, stats.level);
+		any = true;
+	};
+	addSocket(bsocket);
+	for (Socket const *sock : connected_bsocket)
+	{
+		addSocket(sock);
+	}
+	return any;
+}
+
+/**
+ * The compression statistics of the host's connection to a client.
+ * @return false if there is no such compressed connection (always, on clients - their only connection is in the total).
+ */
+bool NETgetConnectionCompressionStats(unsigned index, SocketCompressionStats &stats)
+{
+	ASSERT_OR_RETURN(false, index < MAX_CONNECTED_PLAYERS, "Invalid connection index %u", index);
+	return connected_bsocket[index] != nullptr && socketGetCompressionStats(connected_bsocket[index], &stats);
+}
+
 
 void NETsetPlayerConnectionStatus(CONNECTION_STATUS status, unsigned player)
 {
@@ -4043,6 +4159,179 @@ struct SyncDebugIntList : public SyncDebugEntry
 	unsigned numInts;
 };
 
+enum SyncDebugArgType
+{
+	SYNC_DEBUG_ARG_END,          ///< No more conversions in the format string.
+	SYNC_DEBUG_ARG_PERCENT,      ///< "%%", takes no argument.
+	SYNC_DEBUG_ARG_INT,
+	SYNC_DEBUG_ARG_LONG,
+	SYNC_DEBUG_ARG_LONG_LONG,
+	SYNC_DEBUG_ARG_SIZE,
+	SYNC_DEBUG_ARG_INTMAX,
+	SYNC_DEBUG_ARG_PTRDIFF,
+	SYNC_DEBUG_ARG_DOUBLE,
+	SYNC_DEBUG_ARG_POINTER,
+	SYNC_DEBUG_ARG_STRING,
+	SYNC_DEBUG_ARG_UNSUPPORTED,  ///< Things like "%*d", "%n" or "%Lf", which _syncDebug() formats straight away instead.
+};
+
+#define MAX_SYNC_DEBUG_SPEC 24
+
+/// Finds the next conversion in a printf format string, and returns the type of argument it takes.
+/// The conversion is [specBegin, format) afterwards, and any literal text before it is [old format, specBegin).
+static SyncDebugArgType syncDebugNextConversion(char const *&format, char const *&specBegin)
+{
+	specBegin = strchr(format, '%');
+	if (specBegin == nullptr)
+	{
+		format += strlen(format);
+		specBegin = format;
+		return SYNC_DEBUG_ARG_END;
+	}
+	char const *p = specBegin + 1;
+	p += strspn(p, "-+ #0");
+	p += strspn(p, "0123456789");
+	if (*p == '.')
+	{
+		++p;
+		p += strspn(p, "0123456789");
+	}
+	char const *length = p;
+	SyncDebugArgType intType = SYNC_DEBUG_ARG_INT;
+	switch (*p)
+	{
+	case 'h': ++p; if (*p == 'h') { ++p; } break;
+	case 'l': ++p; intType = SYNC_DEBUG_ARG_LONG; if (*p == 'l') { ++p; intType = SYNC_DEBUG_ARG_LONG_LONG; } break;
+	case 'z': ++p; intType = SYNC_DEBUG_ARG_SIZE; break;
+	case 'j': ++p; intType = SYNC_DEBUG_ARG_INTMAX; break;
+	case 't': ++p; intType = SYNC_DEBUG_ARG_PTRDIFF; break;
+	default: break;
+	}
+	bool hasLength = p != length;
+	char conversion = *p;
+	format = conversion != '\0' ? p + 1 : p;
+	if (format - specBegin >= MAX_SYNC_DEBUG_SPEC)
+	{
+		return SYNC_DEBUG_ARG_UNSUPPORTED;
+	}
+	switch (conversion)
+	{
+	case '%':
+		return p == specBegin + 1 ? SYNC_DEBUG_ARG_PERCENT : SYNC_DEBUG_ARG_UNSUPPORTED;
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+		return intType;
+	case 'c':
+		return !hasLength ? SYNC_DEBUG_ARG_INT : SYNC_DEBUG_ARG_UNSUPPORTED;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+		return !hasLength || intType == SYNC_DEBUG_ARG_LONG ? SYNC_DEBUG_ARG_DOUBLE : SYNC_DEBUG_ARG_UNSUPPORTED;
+	case 's':
+		return !hasLength ? SYNC_DEBUG_ARG_STRING : SYNC_DEBUG_ARG_UNSUPPORTED;
+	case 'p':
+		return !hasLength ? SYNC_DEBUG_ARG_POINTER : SYNC_DEBUG_ARG_UNSUPPORTED;
+	default:
+		return SYNC_DEBUG_ARG_UNSUPPORTED;
+	}
+}
+
+/// CRCs of function names and format strings, so each syncDebug() call only has to add 4 bytes per string to the CRC, instead of the whole text.
+/// Keyed by pointer, since syncDebug() is only ever called with string literals (and __FUNCTION__).
+static std::unordered_map<char const *, uint32_t> syncDebugTextIds;
+
+static uint32_t syncDebugTextId(char const *text)
+{
+	auto i = syncDebugTextIds.find(text);
+	if (i == syncDebugTextIds.end())
+	{
+		i = syncDebugTextIds.emplace(text, htonl(crcSum(0x00000000, text, strlen(text) + 1))).first;
+	}
+	return i->second;
+}
+
+/// A syncDebug() call, stored as the format string and the raw argument values. Only formatted if the log is actually dumped.
+struct SyncDebugFormat : public SyncDebugEntry
+{
+	/// Reads the arguments from ap, appending them to args and chars. Returns false if the format string has conversions that aren't supported.
+	bool set(uint32_t &crc, char const *f, char const *fmt, va_list ap, std::vector<uint64_t> &args, std::vector<char> &chars)
+	{
+		function = f;
+		format = fmt;
+		uint32_t newCrc = crc;
+		uint32_t ids[2] = {syncDebugTextId(function), syncDebugTextId(format)};
+		newCrc = crcSum(newCrc, ids, sizeof(ids));
+		while (true)
+		{
+			char const *specBegin;
+			uint64_t value = 0;
+			switch (syncDebugNextConversion(fmt, specBegin))
+			{
+			case SYNC_DEBUG_ARG_END:         crc = newCrc; return true;
+			case SYNC_DEBUG_ARG_PERCENT:     continue;
+			case SYNC_DEBUG_ARG_INT:         value = (int64_t)va_arg(ap, int); break;
+			case SYNC_DEBUG_ARG_LONG:        value = (int64_t)va_arg(ap, long); break;
+			case SYNC_DEBUG_ARG_LONG_LONG:   value = (int64_t)va_arg(ap, long long); break;
+			case SYNC_DEBUG_ARG_SIZE:        value = va_arg(ap, size_t); break;
+			case SYNC_DEBUG_ARG_INTMAX:      value = (int64_t)va_arg(ap, intmax_t); break;
+			case SYNC_DEBUG_ARG_PTRDIFF:     value = (int64_t)va_arg(ap, ptrdiff_t); break;
+			case SYNC_DEBUG_ARG_DOUBLE:      { double d = va_arg(ap, double); memcpy(&value, &d, sizeof(value)); break; }
+			case SYNC_DEBUG_ARG_POINTER:     value = (uintptr_t)va_arg(ap, void *); break;
+			case SYNC_DEBUG_ARG_STRING:
+				{
+					char const *s = va_arg(ap, char const *);
+					if (s == nullptr)
+					{
+						s = "(null)";
+					}
+					size_t len = strlen(s) + 1;
+					chars.insert(chars.end(), s, s + len);
+					newCrc = crcSum(newCrc, s, len);
+					continue;
+				}
+			case SYNC_DEBUG_ARG_UNSUPPORTED: return false;
+			}
+			args.push_back(value);
+			uint32_t valueBytes[2] = {htonl(value >> 32), htonl((uint32_t)value)};
+			newCrc = crcSum(newCrc, valueBytes, sizeof(valueBytes));
+		}
+	}
+	int snprint(char *buf, size_t bufSize, uint64_t const *&args, char const *&string) const
+	{
+		size_t index = snprintf(buf, bufSize, "[%s] ", function);
+		char const *fmt = format;
+		while (true)
+		{
+			char const *literal = fmt;
+			char const *specBegin;
+			SyncDebugArgType type = syncDebugNextConversion(fmt, specBegin);
+			if (index < bufSize && specBegin != literal)
+			{
+				index += snprintf(buf + index, bufSize - index, "%.*s", (int)(specBegin - literal), literal);
+			}
+			char spec[MAX_SYNC_DEBUG_SPEC];
+			sstrcpy(spec, specBegin);
+			spec[fmt - specBegin] = '\0';
+			char *out = buf + std::min(index, bufSize);
+			size_t outSize = bufSize - std::min(index, bufSize);
+			switch (type)
+			{
+			case SYNC_DEBUG_ARG_END:         index += snprintf(out, outSize, "\n"); return index;
+			case SYNC_DEBUG_ARG_PERCENT:     index += snprintf(out, outSize, "%%"); break;
+			case SYNC_DEBUG_ARG_INT:         index += snprintf(out, outSize, spec, (int)*args++); break;
+			case SYNC_DEBUG_ARG_LONG:        index += snprintf(out, outSize, spec, (long)*args++); break;
+			case SYNC_DEBUG_ARG_LONG_LONG:   index += snprintf(out, outSize, spec, (long long)*args++); break;
+			case SYNC_DEBUG_ARG_SIZE:        index += snprintf(out, outSize, spec, (size_t)*args++); break;
+			case SYNC_DEBUG_ARG_INTMAX:      index += snprintf(out, outSize, spec, (intmax_t)*args++); break;
+			case SYNC_DEBUG_ARG_PTRDIFF:     index += snprintf(out, outSize, spec, (ptrdiff_t)*args++); break;
+			case SYNC_DEBUG_ARG_DOUBLE:      { double d; memcpy(&d, args++, sizeof(d)); index += snprintf(out, outSize, spec, d); break; }
+			case SYNC_DEBUG_ARG_POINTER:     index += snprintf(out, outSize, spec, (void *)(uintptr_t)*args++); break;
+			case SYNC_DEBUG_ARG_STRING:      index += snprintf(out, outSize, spec, string); string += strlen(string) + 1; break;
+			case SYNC_DEBUG_ARG_UNSUPPORTED: abort(); break;  // set() would have returned false.
+			}
+		}
+	}
+
+	char const *format;
+};
+
 struct SyncDebugLog
 {
 	SyncDebugLog() : time(0), crc(0x00000000) {}
@@ -4055,8 +4344,10 @@ struct SyncDebugLog
 		strings.clear();
 		valueChanges.clear();
 		intLists.clear();
+		formats.clear();
 		chars.clear();
 		ints.clear();
+		args.clear();
 	}
 	void string(char const *f, char const *s)
 	{
@@ -4087,13 +4378,30 @@ struct SyncDebugLog
 		intLists.back().set(crc, f, s, buf, num);
 		log.push_back('i');
 	}
+	bool format(char const *f, char const *fmt, va_list ap)
+	{
+		size_t oldNumArgs = args.size();
+		size_t oldNumChars = chars.size();
+		formats.resize(formats.size() + 1);
+		if (!formats.back().set(crc, f, fmt, ap, args, chars))
+		{
+			formats.pop_back();
+			args.resize(oldNumArgs);
+			chars.resize(oldNumChars);
+			return false;
+		}
+		log.push_back('f');
+		return true;
+	}
 	int snprint(char *buf, size_t bufSize)
 	{
 		SyncDebugString const *stringPtr = strings.empty() ? nullptr : &strings[0]; // .empty() check, since &strings[0] is undefined if strings is empty(), even if it's likely to work, anyway.
 		SyncDebugValueChange const *valueChangePtr = valueChanges.empty() ? nullptr : &valueChanges[0];
 		SyncDebugIntList const *intListPtr = intLists.empty() ? nullptr : &intLists[0];
+		SyncDebugFormat const *formatPtr = formats.empty() ? nullptr : &formats[0];
 		char const *charPtr = chars.empty() ? nullptr : &chars[0];
 		int const *intPtr = ints.empty() ? nullptr : &ints[0];
+		uint64_t const *argPtr = args.empty() ? nullptr : &args[0];
 
 		int index = 0;
 		for (size_t n = 0; n < log.size() && (size_t)index < bufSize; ++n)
@@ -4110,6 +4418,9 @@ struct SyncDebugLog
 			case 'i':
 				index += intListPtr++->snprint(buf + index, bufSize - index, intPtr);
 				break;
+			case 'f':
+				index += formatPtr++->snprint(buf + index, bufSize - index, argPtr, charPtr);
+				break;
 			default:
 				abort();
 				break;
@@ -4146,9 +4457,11 @@ private:
 	std::vector<SyncDebugString> strings;
 	std::vector<SyncDebugValueChange> valueChanges;
 	std::vector<SyncDebugIntList> intLists;
+	std::vector<SyncDebugFormat> formats;
 
 	std::vector<char> chars;
 	std::vector<int> ints;
+	std::vector<uint64_t> args;
 
 private:
 	SyncDebugLog(SyncDebugLog const &)/* = delete*/;
@@ -4175,8 +4488,15 @@ void _syncDebug(const char *function, const char *str, ...)
 #endif
 
 	va_list ap;
-	char outputBuffer[MAX_LEN_LOG_LINE];
+	va_start(ap, str);
+	bool stored = syncDebugLog[syncDebugNext].format(function, str, ap);
+	va_end(ap);
+	if (stored)
+	{
+		return;  // Formatted later, if the log is ever dumped.
+	}
 
+	char outputBuffer[MAX_LEN_LOG_LINE];
 	va_start(ap, str);
 	vssprintf(outputBuffer, str, ap);
 	va_end(ap);
@@ -4430,6 +4750,7 @@ const char *messageTypeToString(unsigned messageType_)
 	case GAME_SYNC_REQUEST:             return "GAME_SYNC_REQUEST";
 
 	// The following messages are used for debug mode.
+	case GAME_STATE_HASH:               return "GAME_STATE_HASH";
 	case GAME_DEBUG_MODE:               return "GAME_DEBUG_MODE";
 	case GAME_DEBUG_ADD_DROID:          return "GAME_DEBUG_ADD_DROID";
 	case GAME_DEBUG_ADD_STRUCTURE:      return "GAME_DEBUG_ADD_STRUCTURE";
@@ -111,6 +111,7 @@ enum MESSAGE_TYPES
 	GAME_PLAYER_LEFT,               ///< Player has left or dropped.
 	GAME_DROIDDISEMBARK,            ///< droid disembarked from a Transporter
 	GAME_SYNC_REQUEST,		///< Game event generated from scripts that is meant to be synced
+	GAME_STATE_HASH,                ///< Per-subsystem game state hashes, for finding desynchs.
 	// The following messages are used for debug mode.
 	GAME_DEBUG_MODE,                ///< Request enable/disable debug mode.
 	GAME_DEBUG_ADD_DROID,           ///< Add droid.
@@ -382,6 +383,15 @@ void NETsetGameserverPort(unsigned int port);
 unsigned int NETgetGameserverPort();
 void NETsetJoinPreferenceIPv6(bool bTryIPv6First);
 bool NETgetJoinPreferenceIPv6();
+void NETsetCompressionLevel(int level);
+int NETgetCompressionLevel();
+void NETsetCompressionStrategy(const std::string &strategy);
+std::string NETgetCompressionStrategy();
+void NETsetAdaptiveCompression(bool adaptive);
+bool NETgetAdaptiveCompression();
+struct SocketCompressionStats;
+bool NETgetCompressionStats(SocketCompressionStats &total);
+bool NETgetConnectionCompressionStats(unsigned index, SocketCompressionStats &stats);
 
 bool NETsetupTCPIP(const char *machine);
 void NETsetGamePassword(const char *password);
@@ -408,6 +418,7 @@ bool NETcheckPlayerConnectionStatus(CONNECTION_STATUS status, unsigned player);
 const char *messageTypeToString(unsigned messageType);
 
 /// Sync debugging. Only prints anything, if different players would print different things.
+/// The arguments are stored raw and CRCed as binary, the text is only formatted if a desynch log is dumped.
 #define syncDebug(...) do { _syncDebug(__FUNCTION__, __VA_ARGS__); } while(0)
 #ifdef WZ_CC_MINGW
 void _syncDebug(const char *function, const char *str, ...) WZ_DECL_FORMAT(__MINGW_PRINTF_FORMAT, 2, 3);
@@ -118,17 +118,51 @@ uint8_t *NetMessage::rawDataDup() const
 	return ret;
 }
 
+void NetMessage::rawDataAppendToVector(std::vector<uint8_t> &output) const
+{
+	unsigned encodedLengthOfSize = encodedlength_uint32_t(data.size());
+
+	output.push_back(type);
+
+	uint32_t len = data.size();
+	for (unsigned n = 0; n < encodedLengthOfSize; ++n)
+	{
+		uint8_t b;
+		encode_uint32_t(b, len, n);
+		output.push_back(b);
+	}
+
+	output.insert(output.end(), data.begin(), data.end());
+}
+
 size_t NetMessage::rawLen() const
 {
 	return 1 + static_cast<size_t>(encodedlength_uint32_t(data.size())) + data.size();
 }
 
+// Popped data buffers larger than this are freed, rather than kept for reuse (file transfers and the like are not worth keeping around).
+static const size_t MAX_SPARE_DATA_CAPACITY = 16384;
+// Enough buffers for a few game ticks' worth of messages.
+static const size_t MAX_SPARE_DATA_BUFFERS = 256;
+
 NetQueue::NetQueue()
 	: canGetMessagesForNet(true)
 	, canGetMessages(true)
+	, dataPos(0)
+	, messagePos(0)
+{
+}
+
+NetMessage &NetQueue::newMessage(uint8_t type)
 {
-	dataPos = messages.end();
-	messagePos = messages.end();
+	messages.push_back(NetMessage(type));
+	NetMessage &message = messages.back();
+	if (!spareData.empty())
+	{
+		message.data.swap(spareData.back());
+		spareData.pop_back();
+	}
+	return message;
 }
 
 void NetQueue::writeRawData(const uint8_t *netData, size_t netLen)
@@ -159,8 +193,7 @@ void NetQueue::writeRawData(const uint8_t *netData, size_t netLen)
 			break;  // Don't have a whole message ready yet.
 		}
 
-		messages.push_front(NetMessage(type));
-		messages.front().data.assign(buffer.begin() + used + headerLen, buffer.begin() + used + headerLen + len);
+		newMessage(type).data.assign(buffer.begin() + used + headerLen, buffer.begin() + used + headerLen + len);
 		used += headerLen + len;
 	}
 
@@ -175,36 +208,30 @@ void NetQueue::setWillNeverGetMessagesForNet()
 
 unsigned NetQueue::numMessagesForNet() const
 {
-	unsigned count = 0;
-	if (canGetMessagesForNet)
+	if (!canGetMessagesForNet)
 	{
-		for (List::iterator i = dataPos; i != messages.begin(); --i)
-		{
-			++count;
-		}
+		return 0;
 	}
 
-	return count;
+	return static_cast<unsigned>(messages.size() - dataPos);
 }
 
 const NetMessage &NetQueue::getMessageForNet() const
 {
 	ASSERT(canGetMessagesForNet, "Wrong NetQueue type for getMessageForNet.");
-	ASSERT(dataPos != messages.begin(), "No message to get!");
+	ASSERT(dataPos < messages.size(), "No message to get!");
 
 	// Return the message.
-	List::iterator i = dataPos;
-	--i;
-	return *i;
+	return messages[dataPos];
 }
 
 void NetQueue::popMessageForNet()
 {
 	ASSERT(canGetMessagesForNet, "Wrong NetQueue type for popMessageForNet.");
-	ASSERT(dataPos != messages.begin(), "No message to pop!");
+	ASSERT(dataPos < messages.size(), "No message to pop!");
 
 	// Pop the message.
-	--dataPos;
+	++dataPos;
 
 	// Recycle old data.
 	popOldMessages();
@@ -212,7 +239,7 @@ void NetQueue::popMessageForNet()
 
 void NetQueue::pushMessage(const NetMessage &message)
 {
-	messages.push_front(message);
+	newMessage(message.type).data.assign(message.data.begin(), message.data.end());
 }
 
 void NetQueue::setWillNeverGetMessages()
@@ -223,27 +250,25 @@ void NetQueue::setWillNeverGetMessages()
 bool NetQueue::haveMessage() const
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for haveMessage.");
-	return messagePos != messages.begin();
+	return messagePos < messages.size();
 }
 
 const NetMessage &NetQueue::getMessage() const
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for getMessage.");
-	ASSERT(messagePos != messages.begin(), "No message to get!");
+	ASSERT(messagePos < messages.size(), "No message to get!");
 
 	// Return the message.
-	List::iterator i = messagePos;
-	--i;
-	return *i;
+	return messages[messagePos];
 }
 
 void NetQueue::popMessage()
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for popMessage.");
-	ASSERT(messagePos != messages.begin(), "No message to pop!");
+	ASSERT(messagePos < messages.size(), "No message to pop!");
 
 	// Pop the message.
-	--messagePos;
+	++messagePos;
 
 	// Recycle old data.
 	popOldMessages();
@@ -253,27 +278,25 @@ void NetQueue::popOldMessages()
 {
 	if (!canGetMessagesForNet)
 	{
-		dataPos = messages.begin();
+		dataPos = messages.size();
 	}
 	if (!canGetMessages)
 	{
-		messagePos = messages.begin();
-	}
-
-	List::iterator i = messages.end();
-	while (i != dataPos && i != messagePos)
-	{
-		--i;
+		messagePos = messages.size();
 	}
 
-	if (i == dataPos)
-	{
-		dataPos = messages.end();  // Old iterator will become invalid.
-	}
-	if (i == messagePos)
+	size_t numOld = std::min(dataPos, messagePos);
+	for (size_t i = 0; i < numOld; ++i)
 	{
-		messagePos = messages.end();  // Old iterator will become invalid.
+		std::vector<uint8_t> &data = messages.front().data;
+		if (spareData.size() < MAX_SPARE_DATA_BUFFERS && data.capacity() <= MAX_SPARE_DATA_CAPACITY)
+		{
+			data.clear();
+			spareData.push_back(std::vector<uint8_t>());
+			spareData.back().swap(data);
+		}
+		messages.pop_front();
 	}
-
-	messages.erase(i, messages.end());
+	dataPos -= numOld;
+	messagePos -= numOld;
 }
@@ -46,6 +46,7 @@ class NetMessage
 public:
 	NetMessage(uint8_t type_ = 0xFF) : type(type_) {}
 	uint8_t *rawDataDup() const;  ///< Returns data compatible with NetQueue::writeRawData(). Must be delete[]d.
+	void rawDataAppendToVector(std::vector<uint8_t> &output) const;  ///< Appends the same data as rawDataDup() returns, without allocating if output has enough capacity.
 	size_t rawLen() const;        ///< Returns the length of the return value of rawDataDup().
 	uint8_t type;
 	std::vector<uint8_t> data;
@@ -115,6 +116,7 @@ public:
 
 private:
 	void popOldMessages();                                             ///< Pops any messages that are no longer needed.
+	NetMessage &newMessage(uint8_t type);                              ///< Appends an empty message, reusing the data buffer of a popped message if there is one.
 
 	// Disable copy constructor and assignment operator.
 	NetQueue(const NetQueue &);         // TODO When switching to C++0x, use "= delete" notation.
@@ -123,10 +125,14 @@ private:
 	bool canGetMessagesForNet;                                         ///< True if we will send the messages over the network, false if we don't.
 	bool canGetMessages;                                               ///< True if we will get the messages, false if we don't use them ourselves.
 
-	typedef std::list<NetMessage> List;
-	List::iterator                dataPos;                             ///< Last message which was sent over the network.
-	List::iterator                messagePos;                          ///< Last message which was popped.
-	List                          messages;                            ///< List of messages. Messages are added to the front and read from the back.
+	// The deque is allocated in blocks of several messages, and never moves a message while it is queued, so references returned by
+	// getMessage() and getMessageForNet() stay valid while more messages are pushed. The data buffers of popped messages are kept in
+	// spareData, so that a queue in a steady state does not allocate per message.
+	typedef std::deque<NetMessage> Queue;
+	size_t                        dataPos;                             ///< Index in messages of the next message to send over the network.
+	size_t                        messagePos;                          ///< Index in messages of the next message to return from getMessage().
+	Queue                         messages;                            ///< Queue of messages. Messages are added to the back and popped from the front.
+	std::vector<std::vector<uint8_t>> spareData;                       ///< Emptied data buffers of popped messages, for reuse.
 	std::vector<uint8_t>          incompleteReceivedMessageData;       ///< Data from network which has not yet formed an entire message.
 };
 
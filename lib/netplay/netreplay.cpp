@@ -0,0 +1,241 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2021  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+// ////////////////////////////////////////////////////////////////////////
+// Includes
+#include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
+#include "lib/gamelib/gtime.h"
+
+#include <physfs.h>
+#include "lib/framework/physfs_ext.h"
+
+#include "netreplay.h"
+#include "netplay.h"
+#include "nettypes.h"
+
+#include <vector>
+
+// File layout, all integers big-endian:
+//   "WZrp", uint32_t format version, uint32_t netcode major version, uint32_t netcode minor version,
+//   uint32_t settings length, settings,
+//   then for each game message: uint8_t player, uint32_t length, message (as from NetMessage::rawDataAppendToVector),
+//   and finally a player of REPLAY_END_MARKER. Replays of games that crashed lack the end marker, but are otherwise fine.
+
+static const char REPLAY_MAGIC[4] = {'W', 'Z', 'r', 'p'};
+static const uint32_t REPLAY_FORMAT_VERSION = 1;
+static const uint8_t REPLAY_END_MARKER = 0xFF;
+static const size_t REPLAY_WRITE_BUFFER_SIZE = 65536;  // Write to disk in chunks, not once per message.
+
+static PHYSFS_file *saveHandle = nullptr;
+static std::vector<uint8_t> saveBuffer;
+
+static bool replayLoaded = false;
+static bool replayFinished = false;
+static std::vector<uint8_t> loadData;  // Replays are read into memory in one go, so playback never waits for the disk.
+static size_t loadPos = 0;
+static uint32_t loadStartTicks = 0;
+static size_t loadedMessages = 0;
+
+static void appendUBE32(std::vector<uint8_t> &buffer, uint32_t value)
+{
+	buffer.push_back(value >> 24);
+	buffer.push_back(value >> 16);
+	buffer.push_back(value >> 8);
+	buffer.push_back(value);
+}
+
+static bool readUBE32(uint32_t &value)
+{
+	if (loadData.size() - loadPos < 4)
+	{
+		return false;
+	}
+	value = uint32_t(loadData[loadPos]) << 24 | uint32_t(loadData[loadPos + 1]) << 16 | uint32_t(loadData[loadPos + 2]) << 8 | uint32_t(loadData[loadPos + 3]);
+	loadPos += 4;
+	return true;
+}
+
+static bool flushSaveBuffer()
+{
+	if (saveBuffer.empty())
+	{
+		return true;
+	}
+	bool ok = WZ_PHYSFS_writeBytes(saveHandle, saveBuffer.data(), static_cast<PHYSFS_uint32>(saveBuffer.size())) == static_cast<PHYSFS_sint64>(saveBuffer.size());
+	saveBuffer.clear();
+	return ok;
+}
+
+bool NETreplaySaveStart(std::string const &filename, std::string const &settings)
+{
+	ASSERT_OR_RETURN(false, saveHandle == nullptr, "Already recording a replay");
+
+	saveHandle = PHYSFS_openWrite(filename.c_str());
+	if (saveHandle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not create replay file %s: %s", filename.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+
+	saveBuffer.clear();
+	saveBuffer.reserve(REPLAY_WRITE_BUFFER_SIZE + 1024);
+	saveBuffer.insert(saveBuffer.end(), REPLAY_MAGIC, REPLAY_MAGIC + sizeof(REPLAY_MAGIC));
+	appendUBE32(saveBuffer, REPLAY_FORMAT_VERSION);
+	appendUBE32(saveBuffer, NETGetMajorVersion());
+	appendUBE32(saveBuffer, NETGetMinorVersion());
+	appendUBE32(saveBuffer, static_cast<uint32_t>(settings.size()));
+	saveBuffer.insert(saveBuffer.end(), settings.begin(), settings.end());
+
+	debug(LOG_INFO, "Recording replay to %s", filename.c_str());
+	return true;
+}
+
+void NETreplaySaveNetMessage(NetMessage const &message, uint8_t player)
+{
+	if (saveHandle == nullptr)
+	{
+		return;
+	}
+
+	saveBuffer.push_back(player);
+	appendUBE32(saveBuffer, static_cast<uint32_t>(message.rawLen()));
+	message.rawDataAppendToVector(saveBuffer);
+
+	if (saveBuffer.size() >= REPLAY_WRITE_BUFFER_SIZE && !flushSaveBuffer())
+	{
+		debug(LOG_ERROR, "Could not write replay, stopping recording: %s", WZ_PHYSFS_getLastError());
+		PHYSFS_close(saveHandle);
+		saveHandle = nullptr;
+	}
+}
+
+bool NETreplaySaveStop()
+{
+	if (saveHandle == nullptr)
+	{
+		return false;
+	}
+
+	saveBuffer.push_back(REPLAY_END_MARKER);
+	bool ok = flushSaveBuffer();
+	ok = PHYSFS_close(saveHandle) != 0 && ok;
+	saveHandle = nullptr;
+	saveBuffer = std::vector<uint8_t>();
+
+	if (!ok)
+	{
+		debug(LOG_ERROR, "Could not finish writing replay: %s", WZ_PHYSFS_getLastError());
+	}
+	return ok;
+}
+
+bool NETreplayLoadStart(std::string const &filename, std::string &settings)
+{
+	NETreplayLoadStop();
+
+	PHYSFS_file *handle = PHYSFS_openRead(filename.c_str());
+	if (handle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not open replay %s: %s", filename.c_str(), WZ_PHYSFS_getLastError());
+		return false;
+	}
+	PHYSFS_sint64 length = PHYSFS_fileLength(handle);
+	if (length < 0 || static_cast<uint64_t>(length) > UINT32_MAX)
+	{
+		debug(LOG_ERROR, "Could not read replay %s", filename.c_str());
+		PHYSFS_close(handle);
+		return false;
+	}
+	loadData.resize(static_cast<size_t>(length));
+	bool readOk = WZ_PHYSFS_readBytes(handle, loadData.data(), static_cast<PHYSFS_uint32>(length)) == length;
+	PHYSFS_close(handle);
+	loadPos = 0;
+
+	uint32_t formatVersion = 0, majorVersion = 0, minorVersion = 0, settingsLength = 0;
+	if (!readOk || loadData.size() < sizeof(REPLAY_MAGIC) || memcmp(loadData.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0)
+	{
+		debug(LOG_ERROR, "%s is not a replay", filename.c_str());
+		loadData = std::vector<uint8_t>();
+		return false;
+	}
+	loadPos += sizeof(REPLAY_MAGIC);
+	if (!readUBE32(formatVersion) || formatVersion != REPLAY_FORMAT_VERSION || !readUBE32(majorVersion) || !readUBE32(minorVersion) || !readUBE32(settingsLength) || loadData.size() - loadPos < settingsLength)
+	{
+		debug(LOG_ERROR, "Replay %s is corrupt, or has an unsupported format version %u", filename.c_str(), formatVersion);
+		loadData = std::vector<uint8_t>();
+		return false;
+	}
+	if (!NETisCorrectVersion(majorVersion, minorVersion))
+	{
+		debug(LOG_WARNING, "Replay %s was recorded by netcode version %u.%u, so will probably not play back correctly", filename.c_str(), majorVersion, minorVersion);
+	}
+	settings.assign(loadData.begin() + loadPos, loadData.begin() + loadPos + settingsLength);
+	loadPos += settingsLength;
+
+	replayLoaded = true;
+	replayFinished = false;
+	loadStartTicks = wzGetTicks();
+	loadedMessages = 0;
+	debug(LOG_INFO, "Playing back replay %s", filename.c_str());
+	return true;
+}
+
+bool NETreplayLoadNetMessage()
+{
+	if (!replayLoaded || replayFinished)
+	{
+		return false;
+	}
+
+	uint32_t length = 0;
+	uint8_t player = loadPos < loadData.size() ? loadData[loadPos++] : REPLAY_END_MARKER;
+	if (player == REPLAY_END_MARKER || player >= MAX_PLAYERS || !readUBE32(length) || loadData.size() - loadPos < length)
+	{
+		if (player != REPLAY_END_MARKER)
+		{
+			debug(LOG_WARNING, "Replay ends abruptly, it was probably not saved properly");
+		}
+		replayFinished = true;
+		debug(LOG_INFO, "Replay finished: %zu messages, gameTime %u, took %u ms", loadedMessages, gameTime, wzGetTicks() - loadStartTicks);
+		return false;
+	}
+
+	NETinsertRawData(NETgameQueue(player), &loadData[loadPos], length);
+	loadPos += length;
+	++loadedMessages;
+	return true;
+}
+
+void NETreplayLoadStop()
+{
+	replayLoaded = false;
+	replayFinished = false;
+	loadData = std::vector<uint8_t>();
+	loadPos = 0;
+}
+
+bool NETisReplay()
+{
+	return replayLoaded;
+}
+
+bool NETreplayLoadFinished()
+{
+	return replayFinished;
+}
@@ -0,0 +1,42 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2021  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef _netreplay_h
+#define _netreplay_h
+
+#include "lib/framework/frame.h"
+
+#include "netqueue.h"
+
+#include <string>
+
+// A replay is the game settings, followed by every game message in the order it was processed (see NETrecvGame).
+// Since the game only changes state in response to game messages, feeding the same messages to a game started
+// with the same settings reproduces the game exactly.
+
+bool NETreplaySaveStart(std::string const &filename, std::string const &settings);  ///< Starts recording game messages. settings is whatever the game needs to set itself up again.
+void NETreplaySaveNetMessage(NetMessage const &message, uint8_t player);             ///< Records a game message from player, if recording.
+bool NETreplaySaveStop();
+
+bool NETreplayLoadStart(std::string const &filename, std::string &settings);  ///< Loads a replay for playback, returning the settings it was saved with.
+bool NETreplayLoadNetMessage();  ///< Inserts the next recorded message into its game queue. Returns false at the end of the replay.
+void NETreplayLoadStop();
+bool NETisReplay();              ///< True while playing back a replay. Our own game messages are then discarded, since the replay already has them.
+bool NETreplayLoadFinished();    ///< True once playback has run out of messages.
+
+#endif // _netreplay_h
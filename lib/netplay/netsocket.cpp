@@ -29,8 +29,17 @@
 
 #include <vector>
 #include <algorithm>
+#include <chrono>
 #include <map>
 
+#if defined(WZ_OS_LINUX)
+# include <sys/epoll.h>
+# define WZ_SOCKETSET_EPOLL
+#endif
+#if defined(WZ_OS_UNIX)
+# include <poll.h>
+#endif
+
 #if !defined(ZLIB_CONST)
 #  define ZLIB_CONST
 #endif
@@ -52,7 +61,7 @@ struct Socket
 	 *
 	 * All non-listening sockets will only use the first socket handle.
 	 */
-	Socket() : ready(false), writeError(false), deleteLater(false), isCompressed(false), readDisconnected(false), zDeflateInSize(0)
+	Socket() : ready(false), writeError(false), deleteLater(false), isCompressed(false), readDisconnected(false), zDeflateInSize(0), zDeflateLevel(0), zDeflateMicroseconds(0), zDeflateWindowMicroseconds(0)
 	{
 		memset(&zDeflate, 0, sizeof(zDeflate));
 		memset(&zInflate, 0, sizeof(zInflate));
@@ -73,11 +82,31 @@ struct Socket
 	bool zInflateNeedInput;
 	std::vector<uint8_t> zDeflateOutBuf;
 	std::vector<uint8_t> zInflateInBuf;
+
+	int zDeflateLevel;                     ///< Current deflate level, which adaptive compression may have lowered.
+	uint64_t zDeflateMicroseconds;         ///< Total time spent in deflate().
+	uint64_t zDeflateWindowMicroseconds;   ///< Time spent in deflate() since zDeflateWindowStart.
+	std::chrono::steady_clock::time_point zDeflateWindowStart;
 };
 
+/* Sets made with allocSocketSet() are long-lived, and checked every frame. On Linux, they keep an epoll instance
+ * with their sockets registered, so that checking them costs the same no matter how many sockets (or other game
+ * instances on the same machine) there are. Short-lived sets of a single socket are checked with poll() instead,
+ * which avoids creating an epoll instance for each check. Windows uses select().
+ *
+ * Registrations are level-triggered, so a Socket stays ready for as long as it has unread data, exactly as with
+ * select(). (Edge-triggered would require every reader to drain the socket until EAGAIN.)
+ */
 struct SocketSet
 {
+	SocketSet() {}
+	explicit SocketSet(Socket *sock) : fds(1, sock) {}
+
 	std::vector<Socket *> fds;
+#if defined(WZ_SOCKETSET_EPOLL)
+	int epollFd = -1;
+	mutable std::vector<struct epoll_event> events;
+#endif
 };
 
 
@@ -88,6 +117,16 @@ static bool socketThreadQuit;
 typedef std::map<Socket *, std::vector<uint8_t>> SocketThreadWriteMap;
 static SocketThreadWriteMap socketThreadWrites;
 
+static int socketCompressionLevel = 6;
+static SocketCompressionStrategy socketCompressionStrategy = SOCKET_COMPRESSION_DEFAULT;
+static bool socketCompressionAdaptive = false;
+
+/* Adaptive compression measures the time each socket spends in deflate() over windows of this length. If a
+ * window goes over budget, the next one uses a lower level; if it used less than a quarter of the budget, the
+ * level creeps back up towards socketCompressionLevel. */
+static const auto ADAPTIVE_COMPRESSION_WINDOW = std::chrono::seconds(1);
+static const uint64_t ADAPTIVE_COMPRESSION_BUDGET_MICROSECONDS = 10000;  // 1% of a core per socket.
+
 
 static void socketCloseNow(Socket *sock);
 
@@ -346,7 +385,7 @@ const char *strSockError(int error)
  */
 static bool connectionIsOpen(Socket *sock)
 {
-	const SocketSet set = {std::vector<Socket *>(1, sock)};
+	const SocketSet set(sock);
 
 	ASSERT_OR_RETURN((setSockErr(EBADF), false),
 	                 sock && sock->fd[SOCK_CONNECTION] != INVALID_SOCKET, "Invalid socket");
@@ -394,10 +433,38 @@ static int socketThreadFunction(void *)
 	while (!socketThreadQuit)
 	{
 #if   defined(WZ_OS_UNIX)
-		SOCKET maxfd = INT_MIN;
+		// poll() rather than select(), since checkSockets() accepts sockets with descriptors beyond FD_SETSIZE
+		std::vector<struct pollfd> pfds;
+		for (SocketThreadWriteMap::iterator i = socketThreadWrites.begin(); i != socketThreadWrites.end(); ++i)
+		{
+			if (!i->second.empty())
+			{
+				struct pollfd pfd;
+				pfd.fd = i->first->fd[SOCK_CONNECTION];
+				pfd.events = POLLOUT;
+				pfd.revents = 0;
+				pfds.push_back(pfd);
+			}
+		}
+
+		// Check if we can write to any sockets.
+		wzMutexUnlock(socketThreadMutex);
+		int ret = poll(pfds.empty() ? nullptr : &pfds[0], static_cast<nfds_t>(pfds.size()), 50);
+		wzMutexLock(socketThreadMutex);
+
+		// Hangups and errors count as writable too, as with select, so that the following send reports them.
+		std::vector<SOCKET> writableFds;
+		for (const struct pollfd &pfd : pfds)
+		{
+			if (pfd.revents & (POLLOUT | POLLHUP | POLLERR))
+			{
+				writableFds.push_back(pfd.fd);
+			}
+		}
+		std::sort(writableFds.begin(), writableFds.end());
+		auto isWritable = [&writableFds](SOCKET fd) { return std::binary_search(writableFds.begin(), writableFds.end(), fd); };
 #elif defined(WZ_OS_WIN)
 		SOCKET maxfd = 0;
-#endif
 		fd_set fds;
 		FD_ZERO(&fds);
 		for (SocketThreadWriteMap::iterator i = socketThreadWrites.begin(); i != socketThreadWrites.end(); ++i)
@@ -417,7 +484,10 @@ static int socketThreadFunction(void *)
 		int ret = select(maxfd + 1, nullptr, &fds, nullptr, &tv);
 		wzMutexLock(socketThreadMutex);
 
-		// We can write to some sockets. (Ignore errors from select, we may have deleted the socket after unlocking the mutex, and before calling select.)
+		auto isWritable = [&fds](SOCKET fd) { return FD_ISSET(fd, &fds) != 0; };
+#endif
+
+		// We can write to some sockets. (Ignore errors from poll/select, we may have deleted the socket after unlocking the mutex, and before checking it.)
 		if (ret > 0)
 		{
 			for (SocketThreadWriteMap::iterator i = socketThreadWrites.begin(); i != socketThreadWrites.end();)
@@ -429,7 +499,7 @@ static int socketThreadFunction(void *)
 				std::vector<uint8_t> &writeQueue = w->second;
 				ASSERT(!writeQueue.empty(), "writeQueue[sock] must not be empty.");
 
-				if (!FD_ISSET(sock->fd[SOCK_CONNECTION], &fds))
+				if (!isWritable(sock->fd[SOCK_CONNECTION]))
 				{
 					continue;  // This socket is not ready for writing, or we don't have anything to write.
 				}
@@ -599,6 +669,65 @@ bool socketReadDisconnected(Socket *sock)
 	return sock->readDisconnected;
 }
 
+static int zlibStrategy(SocketCompressionStrategy strategy)
+{
+	switch (strategy)
+	{
+	case SOCKET_COMPRESSION_DEFAULT:      return Z_DEFAULT_STRATEGY;
+	case SOCKET_COMPRESSION_FILTERED:     return Z_FILTERED;
+	case SOCKET_COMPRESSION_HUFFMAN_ONLY: return Z_HUFFMAN_ONLY;
+	case SOCKET_COMPRESSION_RLE:          return Z_RLE;
+	}
+	return Z_DEFAULT_STRATEGY;
+}
+
+static void addDeflateTime(Socket *sock, std::chrono::steady_clock::time_point deflateStart)
+{
+	uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - deflateStart).count();
+	sock->zDeflateMicroseconds += micros;
+	sock->zDeflateWindowMicroseconds += micros;
+}
+
+// Must be called right after flushing, before sending zDeflateOutBuf.
+static void adaptDeflateLevel(Socket *sock)
+{
+	auto now = std::chrono::steady_clock::now();
+	if (!socketCompressionAdaptive || now - sock->zDeflateWindowStart < ADAPTIVE_COMPRESSION_WINDOW)
+	{
+		return;
+	}
+
+	int newLevel = sock->zDeflateLevel;
+	if (sock->zDeflateWindowMicroseconds > ADAPTIVE_COMPRESSION_BUDGET_MICROSECONDS)
+	{
+		newLevel = std::max(newLevel - 1, std::min(1, socketCompressionLevel));  // Never above a configured level of 0
+	}
+	else if (sock->zDeflateWindowMicroseconds < ADAPTIVE_COMPRESSION_BUDGET_MICROSECONDS / 4)
+	{
+		newLevel = std::min(newLevel + 1, socketCompressionLevel);
+	}
+	sock->zDeflateWindowStart = now;
+	sock->zDeflateWindowMicroseconds = 0;
+
+	if (newLevel == sock->zDeflateLevel)
+	{
+		return;
+	}
+
+	// Everything was just flushed, so this should not produce any output, but older zlib versions may emit an empty block.
+	sock->zDeflate.next_in = (Bytef *)nullptr;
+	sock->zDeflate.avail_in = 0;
+	size_t alreadyHave = sock->zDeflateOutBuf.size();
+	sock->zDeflateOutBuf.resize(alreadyHave + 100);
+	sock->zDeflate.next_out = (Bytef *)&sock->zDeflateOutBuf[alreadyHave];
+	sock->zDeflate.avail_out = sock->zDeflateOutBuf.size() - alreadyHave;
+	int ret = deflateParams(&sock->zDeflate, newLevel, zlibStrategy(socketCompressionStrategy));
+	sock->zDeflateOutBuf.resize(sock->zDeflateOutBuf.size() - sock->zDeflate.avail_out);
+	ASSERT_OR_RETURN(, ret == Z_OK || ret == Z_BUF_ERROR, "deflateParams failed!");
+	debug(LOG_NET, "Socket %p deflate level %d -> %d", static_cast<void *>(sock), sock->zDeflateLevel, newLevel);
+	sock->zDeflateLevel = newLevel;
+}
+
 /**
  * Similar to write(2) with the exception that this function will block until
  * <em>all</em> data has been written or an error occurs.
@@ -666,6 +795,7 @@ ssize_t writeAll(Socket *sock, const void *buf, size_t size, size_t *rawByteCoun
 
 			sock->zDeflate.avail_in = size;
 			sock->zDeflateInSize += sock->zDeflate.avail_in;
+			auto deflateStart = std::chrono::steady_clock::now();
 			do
 			{
 				size_t alreadyHave = sock->zDeflateOutBuf.size();
@@ -680,6 +810,7 @@ ssize_t writeAll(Socket *sock, const void *buf, size_t size, size_t *rawByteCoun
 				sock->zDeflateOutBuf.resize(sock->zDeflateOutBuf.size() - sock->zDeflate.avail_out);
 			}
 			while (sock->zDeflate.avail_out == 0);
+			addDeflateTime(sock, deflateStart);
 
 			ASSERT(sock->zDeflate.avail_in == 0, "zlib didn't compress everything!");
 		}
@@ -700,6 +831,7 @@ void socketFlush(Socket *sock, size_t *rawByteCount)
 	}
 
 	// Flush data out of zlib compression state.
+	auto deflateStart = std::chrono::steady_clock::now();
 	do
 	{
 		sock->zDeflate.next_in = (Bytef *)nullptr;
@@ -716,6 +848,8 @@ void socketFlush(Socket *sock, size_t *rawByteCount)
 		sock->zDeflateOutBuf.resize(sock->zDeflateOutBuf.size() - sock->zDeflate.avail_out);
 	}
 	while (sock->zDeflate.avail_out == 0);
+	addDeflateTime(sock, deflateStart);
+	adaptDeflateLevel(sock);
 
 	if (sock->zDeflateOutBuf.empty())
 	{
@@ -755,8 +889,10 @@ void socketBeginCompression(Socket *sock)
 	sock->zDeflate.zalloc = Z_NULL;
 	sock->zDeflate.zfree = Z_NULL;
 	sock->zDeflate.opaque = Z_NULL;
-	int ret = deflateInit(&sock->zDeflate, 6);
+	int ret = deflateInit2(&sock->zDeflate, socketCompressionLevel, Z_DEFLATED, MAX_WBITS, 8, zlibStrategy(socketCompressionStrategy));
 	ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
+	sock->zDeflateLevel = socketCompressionLevel;
+	sock->zDeflateWindowStart = std::chrono::steady_clock::now();
 
 	sock->zInflate.zalloc = Z_NULL;
 	sock->zInflate.zfree = Z_NULL;
@@ -772,6 +908,27 @@ void socketBeginCompression(Socket *sock)
 	wzMutexUnlock(socketThreadMutex);
 }
 
+void socketSetCompressionOptions(int level, SocketCompressionStrategy strategy, bool adaptive)
+{
+	socketCompressionLevel = std::max(std::min(level, 9), 0);
+	socketCompressionStrategy = strategy;
+	socketCompressionAdaptive = adaptive;
+}
+
+bool socketGetCompressionStats(Socket const *sock, SocketCompressionStats *stats)
+{
+	if (!sock->isCompressed)
+	{
+		return false;
+	}
+
+	stats->uncompressedBytes = sock->zDeflate.total_in;
+	stats->compressedBytes = sock->zDeflate.total_out;
+	stats->deflateMicroseconds = sock->zDeflateMicroseconds;
+	stats->level = sock->zDeflateLevel;
+	return true;
+}
+
 Socket::~Socket()
 {
 	if (isCompressed)
@@ -783,11 +940,25 @@ Socket::~Socket()
 
 SocketSet *allocSocketSet()
 {
-	return new SocketSet;
+	SocketSet *set = new SocketSet;
+#if defined(WZ_SOCKETSET_EPOLL)
+	set->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->epollFd == -1)
+	{
+		debug(LOG_WARNING, "epoll_create1 failed, falling back to poll: %s", strSockError(getSockErr()));
+	}
+#endif
+	return set;
 }
 
 void deleteSocketSet(SocketSet *set)
 {
+#if defined(WZ_SOCKETSET_EPOLL)
+	if (set->epollFd != -1)
+	{
+		close(set->epollFd);
+	}
+#endif
 	delete set;
 }
 
@@ -810,6 +981,23 @@ void SocketSet_AddSocket(SocketSet *set, Socket *socket)
 
 	set->fds.push_back(socket);
 	debug(LOG_NET, "Socket added: set->fds[%lu] = %p", (unsigned long)i, static_cast<void *>(socket));
+
+#if defined(WZ_SOCKETSET_EPOLL)
+	if (set->epollFd != -1)
+	{
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = socket;
+		if (epoll_ctl(set->epollFd, EPOLL_CTL_ADD, socket->fd[SOCK_CONNECTION], &event) == -1)
+		{
+			// Not expected to happen - give up on epoll for this set, checkSockets will use poll instead.
+			debug(LOG_ERROR, "epoll_ctl failed, falling back to poll: %s", strSockError(getSockErr()));
+			close(set->epollFd);
+			set->epollFd = -1;
+		}
+	}
+#endif
 }
 
 /**
@@ -822,6 +1010,15 @@ void SocketSet_DelSocket(SocketSet *set, Socket *socket)
 	{
 		debug(LOG_NET, "Socket %p erased (set->fds[%lu])", static_cast<void *>(socket), (unsigned long)i);
 		set->fds.erase(set->fds.begin() + i);
+#if defined(WZ_SOCKETSET_EPOLL)
+		if (set->epollFd != -1 && socket->fd[SOCK_CONNECTION] != INVALID_SOCKET)
+		{
+			// May fail if the socket was already closed, which also removes it from the epoll instance.
+			struct epoll_event event;
+			memset(&event, 0, sizeof(event));
+			epoll_ctl(set->epollFd, EPOLL_CTL_DEL, socket->fd[SOCK_CONNECTION], &event);
+		}
+#endif
 	}
 }
 
@@ -925,12 +1122,6 @@ int checkSockets(const SocketSet *set, unsigned int timeout)
 		return 0;
 	}
 
-#if   defined(WZ_OS_UNIX)
-	SOCKET maxfd = INT_MIN;
-#elif defined(WZ_OS_WIN)
-	SOCKET maxfd = 0;
-#endif
-
 	bool compressedReady = false;
 	for (size_t i = 0; i < set->fds.size(); ++i)
 	{
@@ -941,8 +1132,6 @@ int checkSockets(const SocketSet *set, unsigned int timeout)
 			compressedReady = true;
 			break;
 		}
-
-		maxfd = std::max(maxfd, set->fds[i]->fd[SOCK_CONNECTION]);
 	}
 
 	if (compressedReady)
@@ -959,6 +1148,68 @@ int checkSockets(const SocketSet *set, unsigned int timeout)
 	}
 
 	int ret;
+#if defined(WZ_SOCKETSET_EPOLL)
+	if (set->epollFd != -1)
+	{
+		set->events.resize(set->fds.size());
+		do
+		{
+			ret = epoll_wait(set->epollFd, &set->events[0], static_cast<int>(set->events.size()), static_cast<int>(timeout));
+		}
+		while (ret == SOCKET_ERROR && getSockErr() == EINTR);
+
+		if (ret == SOCKET_ERROR)
+		{
+			debug(LOG_ERROR, "epoll_wait failed: %s", strSockError(getSockErr()));
+			return SOCKET_ERROR;
+		}
+
+		for (size_t i = 0; i < set->fds.size(); ++i)
+		{
+			set->fds[i]->ready = false;
+		}
+		for (int i = 0; i < ret; ++i)
+		{
+			// Hangups and errors count as ready too, as with select, so that the following recv reports them.
+			static_cast<Socket *>(set->events[i].data.ptr)->ready = true;
+		}
+
+		return ret;
+	}
+#endif
+
+#if   defined(WZ_OS_UNIX)
+	std::vector<struct pollfd> pfds(set->fds.size());
+	for (size_t i = 0; i < set->fds.size(); ++i)
+	{
+		pfds[i].fd = set->fds[i]->fd[SOCK_CONNECTION];
+		pfds[i].events = POLLIN;
+		pfds[i].revents = 0;
+	}
+
+	do
+	{
+		ret = poll(&pfds[0], static_cast<nfds_t>(pfds.size()), static_cast<int>(timeout));
+	}
+	while (ret == SOCKET_ERROR && getSockErr() == EINTR);
+
+	if (ret == SOCKET_ERROR)
+	{
+		debug(LOG_ERROR, "poll failed: %s", strSockError(getSockErr()));
+		return SOCKET_ERROR;
+	}
+
+	for (size_t i = 0; i < set->fds.size(); ++i)
+	{
+		set->fds[i]->ready = (pfds[i].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) != 0;
+	}
+#elif defined(WZ_OS_WIN)
+	SOCKET maxfd = 0;
+	for (size_t i = 0; i < set->fds.size(); ++i)
+	{
+		maxfd = std::max(maxfd, set->fds[i]->fd[SOCK_CONNECTION]);
+	}
+
 	fd_set fds;
 	do
 	{
@@ -986,6 +1237,7 @@ int checkSockets(const SocketSet *set, unsigned int timeout)
 	{
 		set->fds[i]->ready = FD_ISSET(set->fds[i]->fd[SOCK_CONNECTION], &fds);
 	}
+#endif
 
 	return ret;
 }
@@ -1008,7 +1260,7 @@ ssize_t readAll(Socket *sock, void *buf, size_t size, unsigned int timeout)
 {
 	ASSERT(!sock->isCompressed, "readAll on compressed sockets not implemented.");
 
-	const SocketSet set = {std::vector<Socket *>(1, sock)};
+	const SocketSet set(sock);
 
 	size_t received = 0;
 
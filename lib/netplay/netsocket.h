@@ -123,6 +123,24 @@ WZ_DECL_NONNULL(1) void socketBeginCompression(Socket *sock); ///< Makes future
 WZ_DECL_NONNULL(1) bool socketReadDisconnected(Socket *sock);  ///< If readNoInt returned 0, returns true if this is the result of a disconnect, or false if the input compressed data just hasn't produced any output bytes.
 WZ_DECL_NONNULL(1) void socketFlush(Socket *sock, size_t *rawByteCount = nullptr); ///< Actually sends the data written with writeAll. Only useful on compressed sockets. Note that flushing too often makes compression less effective. Raw count of bytes (after compression) returned in rawByteCount.
 
+// Compression settings for sockets that begin compression later. They only affect what we send, since inflate can read any zlib stream.
+enum SocketCompressionStrategy
+{
+	SOCKET_COMPRESSION_DEFAULT,
+	SOCKET_COMPRESSION_FILTERED,
+	SOCKET_COMPRESSION_HUFFMAN_ONLY,
+	SOCKET_COMPRESSION_RLE,
+};
+struct SocketCompressionStats
+{
+	uint64_t uncompressedBytes;    ///< Bytes given to deflate.
+	uint64_t compressedBytes;      ///< Bytes deflate produced.
+	uint64_t deflateMicroseconds;  ///< Time spent in deflate.
+	int level;                     ///< Current compression level.
+};
+void socketSetCompressionOptions(int level, SocketCompressionStrategy strategy, bool adaptive);  ///< Sets the deflate level (0-9) and strategy. If adaptive, each socket lowers its level while deflate takes too long, and raises it back up to level when it is cheap again.
+WZ_DECL_NONNULL(1, 2) bool socketGetCompressionStats(Socket const *sock, SocketCompressionStats *stats);  ///< Returns false if the Socket is not compressed.
+
 // Socket sets.
 WZ_DECL_ALLOCATION SocketSet *allocSocketSet();                         ///< Constructs a SocketSet.
 WZ_DECL_NONNULL(1) void deleteSocketSet(SocketSet *set);                ///< Destroys the SocketSet.
@@ -38,6 +38,7 @@
 #include "nettypes.h"
 #include "netqueue.h"
 #include "netlog.h"
+#include "netreplay.h"
 #include "src/order.h"
 #include <cstring>
 
@@ -59,7 +60,7 @@ static NetQueue *broadcastQueue = nullptr;
 // Only used between NETbegin{Encode,Decode} and NETend calls.
 static MessageWriter writer;  ///< Used when serialising a message.
 static MessageReader reader;  ///< Used when deserialising a message.
-static NetMessage message;    ///< A message which is being serialised or deserialised.
+static NetMessage message;    ///< A message which is being serialised.
 static NETQUEUE queueInfo;    ///< Indicates which queue is currently being (de)serialised.
 static PACKETDIR NetDir;      ///< Indicates whether a message is being serialised (PACKET_ENCODE) or deserialised (PACKET_DECODE), or not doing anything (PACKET_INVALID).
 
@@ -464,10 +465,10 @@ void NETbeginDecode(NETQUEUE queue, uint8_t type)
 	NETsetPacketDir(PACKET_DECODE);
 
 	queueInfo = queue;
-	message = receiveQueue(queueInfo)->getMessage();
-	reader = MessageReader(message);
+	// Read straight from the queue, the message stays there until NETpop().
+	reader = MessageReader(receiveQueue(queueInfo)->getMessage());
 
-	assert(type == message.type);
+	assert(type == reader.message->type);
 }
 
 bool NETend()
@@ -475,6 +476,13 @@ bool NETend()
 	// If we are encoding just return true
 	if (NETgetPacketDir() == PACKET_ENCODE)
 	{
+		if (NETisReplay() && (queueInfo.queueType == QUEUE_GAME || queueInfo.queueType == QUEUE_GAME_FORCED))
+		{
+			// The replay already has every game message, including the ones we sent when it was recorded.
+			NETsetPacketDir(PACKET_INVALID);
+			return true;
+		}
+
 		// Push the message onto the list.
 		NetQueue *queue = sendQueue(queueInfo);
 		if (queue == nullptr) {
@@ -666,6 +666,11 @@ void wzYieldCurrentThread()
 	SDL_Delay(40);
 }
 
+unsigned int wzGetLogicalCPUCount()
+{
+	return static_cast<unsigned int>(std::max(SDL_GetCPUCount(), 1));
+}
+
 WZ_MUTEX *wzMutexCreate()
 {
 	return (WZ_MUTEX *)SDL_CreateMutex();
@@ -25,6 +25,8 @@
 #include "lib/framework/frame.h"
 #include "lib/framework/math_ext.h"
 #include "lib/framework/frameresource.h"
+#include "lib/framework/wzthreadpool.h"
+#include "lib/gamelib/gtime.h"
 #include "lib/exceptionhandler/dumpinfo.h"
 
 #include <AL/al.h>
@@ -38,6 +40,11 @@
 #include <string.h>
 #include <math.h>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <unordered_map>
 
 #include "tracklib.h"
 #include "audio.h"
@@ -64,6 +71,11 @@ struct AUDIO_STREAM
 
 	size_t                  bufferSize = 0;
 
+	// The data for the next buffer to refill, decoded ahead by the audio decode thread
+	soundDataBuffer        *decodedAhead = nullptr;
+	bool                    endOfStream = false;
+	bool                    stopRequested = false;
+
 	// Linked list pointer
 	AUDIO_STREAM           *next = nullptr;
 };
@@ -71,11 +83,20 @@ struct AUDIO_STREAM
 struct SAMPLE_LIST
 {
 	AUDIO_SAMPLE   *curr;
+	TRACK          *psVoiceTrack;  // Track of a 3D sample, which competes for the voice budget; NULL for 2D samples
 	SAMPLE_LIST    *next;
 };
 
 static SAMPLE_LIST *active_samples = nullptr;
 
+// At most this many 3D samples get an OpenAL source at a time; less important ones are virtualised.
+#define MAX_3D_VOICES			32
+// A virtual voice must be this much more important than a playing one before they swap, to avoid flip-flopping
+#define VOICE_SWAP_THRESHOLD	1.25f
+
+static Vector3f listenerPos(0.f, 0.f, 0.f);
+static AudioVoiceStats voiceStats;
+
 static AUDIO_STREAM *active_streams = nullptr;
 
 static ALfloat		sfx_volume = 1.0;
@@ -89,6 +110,77 @@ static LPALCGETSTRINGISOFT alcGetStringiSOFT = nullptr;
 static LPALCRESETDEVICESOFT alcResetDeviceSOFT = nullptr;
 #endif
 
+// Decodes stream data ahead of time, between calls to sound_Update(). All OpenAL calls stay on the main thread.
+static WzThreadPool *audioDecodeThread = nullptr;
+
+// Decoded PCM data of recently loaded tracks, so that loading them again (on every level load) needs no decoding.
+// Only used from the main thread.
+struct DecodedTrack
+{
+	std::vector<char> data;
+	unsigned int channelCount;
+	unsigned int frequency;
+	PHYSFS_sint64 fileLength;
+	std::list<std::string>::iterator lruPosition;
+};
+#define DECODED_TRACK_CACHE_LIMIT (16 * 1024 * 1024)
+static std::unordered_map<std::string, DecodedTrack> decodedTrackCache;
+static std::list<std::string> decodedTrackLru;  // Most recently used first
+
+static std::atomic<uint64_t> decodeMicroseconds(0);
+static AudioDecodeStats decodeStats;
+
+AudioDecodeStats sound_GetDecodeStats()
+{
+	AudioDecodeStats stats = decodeStats;
+	stats.decodeMicroseconds = decodeMicroseconds;
+	return stats;
+}
+
+static soundDataBuffer *sound_DecodeTimed(struct OggVorbisDecoderState *decoder, size_t bufferSize)
+{
+	auto start = std::chrono::steady_clock::now();
+	soundDataBuffer *soundBuffer = sound_DecodeOggVorbis(decoder, bufferSize);
+	decodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	return soundBuffer;
+}
+
+static void sound_DecodeAhead(AUDIO_STREAM *stream)
+{
+	if (stream->endOfStream || stream->decodedAhead != nullptr)
+	{
+		return;
+	}
+	if (audioDecodeThread == nullptr)
+	{
+		stream->decodedAhead = sound_DecodeTimed(stream->decoder, stream->bufferSize);
+		return;
+	}
+	audioDecodeThread->addJob([stream]() {
+		stream->decodedAhead = sound_DecodeTimed(stream->decoder, stream->bufferSize);
+	});
+}
+
+/** Must be called before touching any stream's decoder or decodedAhead from the main thread. */
+static void sound_WaitForDecodeAhead()
+{
+	if (audioDecodeThread != nullptr)
+	{
+		audioDecodeThread->waitForAll();
+	}
+}
+
+static void sound_TrimDecodedTrackCache(size_t limit)
+{
+	while (decodeStats.trackCacheBytes > limit && !decodedTrackLru.empty())
+	{
+		auto it = decodedTrackCache.find(decodedTrackLru.back());
+		decodeStats.trackCacheBytes -= it->second.data.size();
+		decodedTrackCache.erase(it);
+		decodedTrackLru.pop_back();
+	}
+}
+
 
 /** Removes the given sample from the "active_samples" linked list
  *  \param previous either NULL (if \c to_remove is the first item in the
@@ -241,6 +333,7 @@ bool sound_InitLibrary(HRTFMode hrtf)
 	debug(LOG_SOUND, "%s", buf);
 
 	openal_initialized = true;
+	audioDecodeThread = new WzThreadPool(1);
 
 #if defined(ALC_SOFT_HRTF)
 	if(alcIsExtensionPresent(device, "ALC_SOFT_HRTF"))
@@ -382,6 +475,9 @@ void sound_ShutdownLibrary(void)
 		sound_StopStream(stream);
 	}
 	sound_UpdateStreams();
+	delete audioDecodeThread;
+	audioDecodeThread = nullptr;
+	sound_TrimDecodedTrackCache(0);
 
 	alcGetError(device);	// clear error codes
 
@@ -451,6 +547,247 @@ unsigned int sound_GetActiveSamplesCount()
 	return num;
 }
 
+AudioVoiceStats sound_GetVoiceStats()
+{
+	AudioVoiceStats stats = voiceStats;
+	stats.budget = MAX_3D_VOICES;
+	for (SAMPLE_LIST *node = active_samples; node != nullptr; node = node->next)
+	{
+		if (node->psVoiceTrack == nullptr)
+		{
+			continue;
+		}
+		if (node->curr->bVirtual)
+		{
+			++stats.virtualVoices;
+		}
+		else if (node->curr->iSample != (ALuint)AL_INVALID)
+		{
+			++stats.voices;
+		}
+	}
+	return stats;
+}
+
+/** How much a 3D sample deserves one of the voices: louder tracks, closer to the listener, and
+ *  one-shot samples that have not mostly played yet are more important.
+ *  \return 0 when the sample is out of earshot, up to 1 otherwise
+ */
+static float sound_VoicePriority(const TRACK *psTrack, const AUDIO_SAMPLE *psSample)
+{
+	const float dX = (float)psSample->x - listenerPos.x;
+	const float dY = (float)psSample->y - listenerPos.y;
+	const float dZ = (float)psSample->z - listenerPos.z;
+	const float distance = sqrtf(dX * dX + dY * dY + dZ * dZ);
+
+	// Same falloff as the gain computed in sound_SetObjectPosition()
+	const float proximity = clip(1.0f - distance * ATTENUATION_FACTOR, 0.0f, 1.0f);
+
+	float freshness = 1.0f;
+	if (!psTrack->bLoop && psTrack->iTime > 0)
+	{
+		const float played = (float)(realTime - psSample->iStartTime) / (float)psTrack->iTime;
+		freshness = 1.0f - 0.5f * std::min(played, 1.0f);
+	}
+
+	return psSample->fVol * proximity * freshness;
+}
+
+/** Creates an OpenAL source for a 3D sample and starts playing it
+ *  \param offset seconds into the track to start at, for virtual voices that get a voice again
+ *  \return false if no source could be created (there are only so many of them)
+ */
+static bool sound_Start3DSource(TRACK *psTrack, AUDIO_SAMPLE *psSample, float offset)
+{
+	ALfloat zero[3] = { 0.0, 0.0, 0.0 };
+
+	// Clear error codes
+	alGetError();
+
+	alGenSources(1, &(psSample->iSample));
+	if (sound_GetError() != AL_NO_ERROR)
+	{
+		psSample->iSample = AL_INVALID;
+		return false;
+	}
+
+#if defined(WZ_OS_UNIX) && !defined(WZ_OS_MAC)
+	// HACK: this is a workaround for a bug in the 64bit implementation of OpenAL on GNU/Linux
+	// The AL_PITCH value really should be 1.0.
+	alSourcef(psSample->iSample, AL_PITCH, 1.001f);
+#else
+	alSourcef(psSample->iSample, AL_PITCH, 1.0f);
+#endif
+
+	sound_SetObjectPosition(psSample);
+	alSourcefv(psSample->iSample, AL_VELOCITY, zero);
+	alSourcei(psSample->iSample, AL_BUFFER, psTrack->iBufferName);
+	alSourcei(psSample->iSample, AL_LOOPING, psTrack->bLoop ? AL_TRUE : AL_FALSE);
+	if (offset > 0.0f)
+	{
+		alSourcef(psSample->iSample, AL_SEC_OFFSET, offset);
+	}
+
+	// NOTE: this is only useful for debugging.
+#ifdef DEBUG
+	psSample->is3d = true;
+	psSample->isLooping = psTrack->bLoop ? AL_TRUE : AL_FALSE;
+	memcpy(psSample->filename, psTrack->fileName, strlen(psTrack->fileName));
+	psSample->filename[strlen(psTrack->fileName)] = '\0';
+#endif
+
+	// Clear error codes
+	alGetError();
+
+	alSourcePlay(psSample->iSample);
+	sound_GetError();
+
+	return true;
+}
+
+/** Takes the OpenAL source away from a playing 3D sample. It keeps "playing" silently, so that it
+ *  can pick up where it would have been if it gets a voice again.
+ */
+static void sound_VirtualiseVoice(AUDIO_SAMPLE *psSample)
+{
+	alGetError();	// clear error codes
+	alSourceStop(psSample->iSample);
+	alDeleteSources(1, &psSample->iSample);
+	sound_GetError();
+	psSample->iSample = AL_INVALID;
+	psSample->bVirtual = true;
+}
+
+/** Gives a virtual voice its OpenAL source back, at the position it would be at had it been playing all along
+ */
+static bool sound_ReviveVoice(TRACK *psTrack, AUDIO_SAMPLE *psSample)
+{
+	UDWORD age = realTime - psSample->iStartTime;
+	if (psTrack->bLoop && psTrack->iTime > 0)
+	{
+		age %= psTrack->iTime;
+	}
+	if (!sound_Start3DSource(psTrack, psSample, age / 1000.0f))
+	{
+		return false;
+	}
+	psSample->bVirtual = false;
+	++voiceStats.revived;
+	return true;
+}
+
+/** Makes room for a new 3D sample within the voice budget, by virtualising the least important
+ *  playing voice if that is less important than the new sample.
+ *  \return false if the new sample should be virtual itself
+ */
+static bool sound_ClaimVoice(TRACK *psTrack, AUDIO_SAMPLE *psSample)
+{
+	const float priority = sound_VoicePriority(psTrack, psSample);
+	AUDIO_SAMPLE *psLeastImportant = nullptr;
+	float leastPriority = 0.0f;
+	unsigned int voices = 0;
+
+	for (SAMPLE_LIST *node = active_samples; node != nullptr; node = node->next)
+	{
+		if (node->psVoiceTrack == nullptr || node->curr->iSample == (ALuint)AL_INVALID)
+		{
+			continue;
+		}
+		++voices;
+		const float nodePriority = sound_VoicePriority(node->psVoiceTrack, node->curr);
+		if (psLeastImportant == nullptr || nodePriority < leastPriority)
+		{
+			psLeastImportant = node->curr;
+			leastPriority = nodePriority;
+		}
+	}
+
+	if (voices < MAX_3D_VOICES)
+	{
+		return true;
+	}
+	if (psLeastImportant != nullptr && leastPriority < priority)
+	{
+		sound_VirtualiseVoice(psLeastImportant);
+		++voiceStats.stolen;
+		return true;
+	}
+	return false;
+}
+
+/** Hands the voices to the most important 3D samples, after the listener or the objects have moved.
+ *  Virtual voices only take over a playing one if they are clearly more important.
+ */
+static void sound_BalanceVoices()
+{
+	struct Voice
+	{
+		SAMPLE_LIST *node;
+		float priority;
+		bool operator <(const Voice &other) const
+		{
+			return priority > other.priority;  // Most important first
+		}
+	};
+	static std::vector<Voice> voices;  // Reused, to not allocate every frame
+	unsigned int playing = 0;
+	bool anyVirtual = false;
+
+	voices.clear();
+	for (SAMPLE_LIST *node = active_samples; node != nullptr; node = node->next)
+	{
+		if (node->psVoiceTrack == nullptr)
+		{
+			continue;
+		}
+		if (node->curr->bVirtual)
+		{
+			anyVirtual = true;
+		}
+		else
+		{
+			++playing;
+		}
+		voices.push_back(Voice{node, sound_VoicePriority(node->psVoiceTrack, node->curr)});
+	}
+	if (!anyVirtual)
+	{
+		return;
+	}
+	std::sort(voices.begin(), voices.end());
+
+	// Virtual voices that made the budget take free voices first, then those of playing voices that did not make it, least important first.
+	size_t loser = voices.size();
+	for (size_t i = 0; i < voices.size() && i < MAX_3D_VOICES; ++i)
+	{
+		AUDIO_SAMPLE *psSample = voices[i].node->curr;
+		if (!psSample->bVirtual)
+		{
+			continue;
+		}
+		if (playing >= MAX_3D_VOICES)
+		{
+			while (loser > MAX_3D_VOICES && voices[loser - 1].node->curr->bVirtual)
+			{
+				--loser;
+			}
+			if (loser <= MAX_3D_VOICES || voices[i].priority <= voices[loser - 1].priority * VOICE_SWAP_THRESHOLD)
+			{
+				break;
+			}
+			--loser;
+			sound_VirtualiseVoice(voices[loser].node->curr);
+			++voiceStats.stolen;
+			--playing;
+		}
+		if (!sound_ReviveVoice(voices[i].node->psVoiceTrack, psSample))
+		{
+			break;
+		}
+		++playing;
+	}
+}
+
 void sound_Update()
 {
 	SAMPLE_LIST *node = active_samples;
@@ -469,6 +806,24 @@ void sound_Update()
 	{
 		ALenum state, err;
 
+		if (node->curr->iSample == (ALuint)AL_INVALID)
+		{
+			// A virtual voice is finished when its track would have been, or when it gets out of earshot (as playing ones do, below).
+			// Anything else without a source was stopped, or never got one.
+			AUDIO_SAMPLE *psSample = node->curr;
+			if (!psSample->bVirtual
+			    || (!node->psVoiceTrack->bLoop && realTime - psSample->iStartTime >= (UDWORD)node->psVoiceTrack->iTime)
+			    || sound_VoicePriority(node->psVoiceTrack, psSample) == 0.0f)
+			{
+				psSample->bVirtual = false;
+				sound_DestroyIteratedSample(&previous, &node);
+				continue;
+			}
+			previous = node;
+			node = node->next;
+			continue;
+		}
+
 		// query what the gain is for this sample
 		alGetSourcef(node->curr->iSample, AL_GAIN, &gain);
 		err = sound_GetError();
@@ -520,6 +875,8 @@ void sound_Update()
 		}
 	}
 
+	sound_BalanceVoices();
+
 	// Reset the current error state
 	alcGetError(device);
 
@@ -590,12 +947,25 @@ bool sound_QueueSamplePlaying(void)
 	return false;
 }
 
+/** Computes the duration of 16 bit PCM data
+ *  \return the duration in milliseconds
+ */
+static SDWORD sound_PCMDuration(size_t size, unsigned int channelCount, unsigned int frequency)
+{
+	if (channelCount == 0 || frequency == 0)
+	{
+		return 0;
+	}
+	const uint64_t frames = size / (2 * channelCount);
+	return static_cast<SDWORD>(frames * 1000 / frequency);
+}
+
 /** Decodes an opened OggVorbis file into an OpenAL buffer
  *  \param psTrack pointer to object which will contain the final buffer
  *  \param PHYSFS_fileHandle file handle given by PhysicsFS to the opened file
  *  \return on success the psTrack pointer, otherwise it will be free'd and a NULL pointer is returned instead
  */
-static inline TRACK *sound_DecodeOggVorbisTrack(TRACK *psTrack, PHYSFS_file *PHYSFS_fileHandle)
+static inline TRACK *sound_DecodeOggVorbisTrack(TRACK *psTrack, PHYSFS_file *PHYSFS_fileHandle, const std::string &cacheKey)
 {
 	ALenum		format;
 	ALuint		buffer;
@@ -607,6 +977,24 @@ static inline TRACK *sound_DecodeOggVorbisTrack(TRACK *psTrack, PHYSFS_file *PHY
 		return nullptr;
 	}
 
+	PHYSFS_sint64 fileLength = PHYSFS_fileLength(PHYSFS_fileHandle);
+	auto cached = decodedTrackCache.find(cacheKey);
+	if (cached != decodedTrackCache.end() && cached->second.fileLength == fileLength)
+	{
+		DecodedTrack const &track = cached->second;
+		format = (track.channelCount == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+		alGenBuffers(1, &buffer);
+		sound_GetError();
+		alBufferData(buffer, format, track.data.data(), static_cast<ALsizei>(track.data.size()), track.frequency);
+		sound_GetError();
+		decodedTrackLru.splice(decodedTrackLru.begin(), decodedTrackLru, cached->second.lruPosition);
+		++decodeStats.trackCacheHits;
+		psTrack->iBufferName = buffer;
+		psTrack->iTime = sound_PCMDuration(track.data.size(), track.channelCount, track.frequency);
+		return psTrack;
+	}
+	++decodeStats.trackCacheMisses;
+
 	decoder = sound_CreateOggVorbisDecoder(PHYSFS_fileHandle, true);
 	if (decoder == nullptr)
 	{
@@ -615,7 +1003,7 @@ static inline TRACK *sound_DecodeOggVorbisTrack(TRACK *psTrack, PHYSFS_file *PHY
 		return nullptr;
 	}
 
-	soundBuffer = sound_DecodeOggVorbis(decoder, 0);
+	soundBuffer = sound_DecodeTimed(decoder, 0);
 	sound_DestroyOggVorbisDecoder(decoder);
 
 	if (soundBuffer == nullptr)
@@ -647,10 +1035,30 @@ static inline TRACK *sound_DecodeOggVorbisTrack(TRACK *psTrack, PHYSFS_file *PHY
 	alBufferData(buffer, format, soundBuffer->data, static_cast<ALsizei>(soundBuffer->size), soundBuffer->frequency);
 	sound_GetError();
 
-	free(soundBuffer);
-
-	// save buffer name in track
+	if (soundBuffer->size <= DECODED_TRACK_CACHE_LIMIT / 4)
+	{
+		if (cached != decodedTrackCache.end())
+		{
+			decodeStats.trackCacheBytes -= cached->second.data.size();
+			decodedTrackLru.erase(cached->second.lruPosition);
+			decodedTrackCache.erase(cached);
+		}
+		decodedTrackLru.push_front(cacheKey);
+		DecodedTrack &track = decodedTrackCache[cacheKey];
+		track.data.assign(soundBuffer->data, soundBuffer->data + soundBuffer->size);
+		track.channelCount = soundBuffer->channelCount;
+		track.frequency = soundBuffer->frequency;
+		track.fileLength = fileLength;
+		track.lruPosition = decodedTrackLru.begin();
+		decodeStats.trackCacheBytes += soundBuffer->size;
+		sound_TrimDecodedTrackCache(DECODED_TRACK_CACHE_LIMIT);
+	}
+
+	// save buffer name and duration in track
 	psTrack->iBufferName = buffer;
+	psTrack->iTime = sound_PCMDuration(soundBuffer->size, soundBuffer->channelCount, soundBuffer->frequency);
+
+	free(soundBuffer);
 
 	return psTrack;
 }
@@ -712,7 +1120,7 @@ TRACK *sound_LoadTrackFromFile(const char *fileName)
 	pTrack->fileName = track_name;
 
 	// Now use sound_ReadTrackFromBuffer to decode the file's contents
-	pTrack = sound_DecodeOggVorbisTrack(pTrack, fileHandle);
+	pTrack = sound_DecodeOggVorbisTrack(pTrack, fileHandle, WZ_PHYSFS_getRealDir_String(fileName) + '\0' + fileName);
 
 	PHYSFS_close(fileHandle);
 	return pTrack;
@@ -724,12 +1132,13 @@ void sound_FreeTrack(TRACK *psTrack)
 	sound_GetError();
 }
 
-static void sound_AddActiveSample(AUDIO_SAMPLE *psSample)
+static void sound_AddActiveSample(AUDIO_SAMPLE *psSample, TRACK *psVoiceTrack)
 {
 	SAMPLE_LIST *tmp = (SAMPLE_LIST *) malloc(sizeof(SAMPLE_LIST));
 
 	// Prepend the given sample to our list of active samples
 	tmp->curr = psSample;
+	tmp->psVoiceTrack = psVoiceTrack;
 	tmp->next = active_samples;
 	active_samples = tmp;
 }
@@ -765,7 +1174,7 @@ void sound_RemoveActiveSample(AUDIO_SAMPLE *psSample)
 
 static bool sound_SetupChannel(AUDIO_SAMPLE *psSample)
 {
-	sound_AddActiveSample(psSample);
+	sound_AddActiveSample(psSample, nullptr);
 
 	return sound_TrackLooped(psSample->iTrack);
 }
@@ -787,6 +1196,8 @@ bool sound_Play2DSample(TRACK *psTrack, AUDIO_SAMPLE *psSample, bool bQueued)
 	volume = ((float)psTrack->iVol / 100.0f);		// each object can have OWN volume!
 	psSample->fVol = volume;						// save computed volume
 	volume *= sfx_volume;							// and now take into account the Users sound Prefs.
+	psSample->bVirtual = false;
+	psSample->iStartTime = realTime;
 
 	// We can't hear it, so don't bother creating it.
 	if (volume == 0.0f)
@@ -848,9 +1259,7 @@ bool sound_Play2DSample(TRACK *psTrack, AUDIO_SAMPLE *psSample, bool bQueued)
 //
 bool sound_Play3DSample(TRACK *psTrack, AUDIO_SAMPLE *psSample)
 {
-	ALfloat zero[3] = { 0.0, 0.0, 0.0 };
 	ALfloat volume;
-	ALint error;
 
 	if (sfx3d_volume == 0.0)
 	{
@@ -865,48 +1274,20 @@ bool sound_Play3DSample(TRACK *psTrack, AUDIO_SAMPLE *psSample)
 	{
 		return false;
 	}
-	// Clear error codes
-	alGetError();
 
-	alGenSources(1, &(psSample->iSample));
+	psSample->iSample = AL_INVALID;
+	psSample->bVirtual = false;
+	psSample->iStartTime = realTime;
+	sound_AddActiveSample(psSample, psTrack);
+	++voiceStats.started;
 
-	error = sound_GetError();
-	if (error != AL_NO_ERROR)
+	// Over the voice budget, or out of OpenAL sources: play on as a virtual voice, which may get a source later.
+	if (!sound_ClaimVoice(psTrack, psSample) || !sound_Start3DSource(psTrack, psSample, 0.0f))
 	{
-		/* FIXME: We run out of OpenAL sources very quickly, so we
-		 * should handle the case where we've ran out of them.
-		 * Currently we don't do this, causing some unpleasant side
-		 * effects, e.g. crashing...
-		 */
+		psSample->bVirtual = true;
+		++voiceStats.virtualised;
 	}
 
-#if defined(WZ_OS_UNIX) && !defined(WZ_OS_MAC)
-	// HACK: this is a workaround for a bug in the 64bit implementation of OpenAL on GNU/Linux
-	// The AL_PITCH value really should be 1.0.
-	alSourcef(psSample->iSample, AL_PITCH, 1.001f);
-#else
-	alSourcef(psSample->iSample, AL_PITCH, 1.0f);
-#endif
-
-	sound_SetObjectPosition(psSample);
-	alSourcefv(psSample->iSample, AL_VELOCITY, zero);
-	alSourcei(psSample->iSample, AL_BUFFER, psTrack->iBufferName);
-	alSourcei(psSample->iSample, AL_LOOPING, (sound_SetupChannel(psSample)) ? AL_TRUE : AL_FALSE);
-
-	// NOTE: this is only useful for debugging.
-#ifdef DEBUG
-	psSample->is3d = true;
-	psSample->isLooping = sound_TrackLooped(psSample->iTrack) ? AL_TRUE : AL_FALSE;
-	memcpy(psSample->filename, psTrack->fileName, strlen(psTrack->fileName));
-	psSample->filename[strlen(psTrack->fileName)] = '\0';
-#endif
-
-	// Clear error codes
-	alGetError();
-
-	alSourcePlay(psSample->iSample);
-	sound_GetError();
-
 	return true;
 }
 
@@ -1020,7 +1401,7 @@ AUDIO_STREAM *sound_PlayStreamWithBuf(PHYSFS_file *fileHandle, float volume, con
 	for (i = 0; i < buffer_count; ++i)
 	{
 		// Decode some audio data
-		soundDataBuffer *soundBuffer = sound_DecodeOggVorbis(stream->decoder, stream->bufferSize);
+		soundDataBuffer *soundBuffer = sound_DecodeTimed(stream->decoder, stream->bufferSize);
 
 		// If we actually decoded some data
 		if (soundBuffer && soundBuffer->size > 0)
@@ -1048,6 +1429,7 @@ AUDIO_STREAM *sound_PlayStreamWithBuf(PHYSFS_file *fileHandle, float volume, con
 			alDeleteBuffers(buffer_count - i, &buffers[i]);
 			sound_GetError();
 
+			stream->endOfStream = true;
 			break;
 		}
 	}
@@ -1093,6 +1475,8 @@ AUDIO_STREAM *sound_PlayStreamWithBuf(PHYSFS_file *fileHandle, float volume, con
 	stream->next = active_streams;
 	active_streams = stream;
 
+	sound_DecodeAhead(stream);
+
 	if(freeBuffers)
 	{
 		free(buffers);
@@ -1136,6 +1520,7 @@ void sound_StopStream(AUDIO_STREAM *stream)
 
 	alGetError();	// clear error codes
 	// Tell OpenAL to stop playing on the given source
+	stream->stopRequested = true;
 	alSourceStop(stream->source);
 	sound_GetError();
 }
@@ -1216,6 +1601,7 @@ void sound_SetStreamVolume(AUDIO_STREAM *stream, float volume)
 
 double sound_GetStreamTotalTime(AUDIO_STREAM *stream)
 {
+	sound_WaitForDecodeAhead();
 	return sound_GetOggVorbisTotalTime(stream->decoder);
 }
 
@@ -1226,13 +1612,20 @@ double sound_GetStreamTotalTime(AUDIO_STREAM *stream)
 static bool sound_UpdateStream(AUDIO_STREAM *stream)
 {
 	ALint state, buffer_count;
+	bool underrun = false;
 
 	alGetSourcei(stream->source, AL_SOURCE_STATE, &state);
 	sound_GetError();
 
 	if (state != AL_PLAYING && state != AL_PAUSED)
 	{
-		return false;
+		// If the source ran dry while there is still data to play, refill it and keep going, instead of cutting it off.
+		if (state != AL_STOPPED || stream->stopRequested || stream->decodedAhead == nullptr || stream->decodedAhead->size == 0)
+		{
+			return false;
+		}
+		underrun = true;
+		++decodeStats.streamUnderruns;
 	}
 
 	// Retrieve the amount of buffers which were processed and need refilling
@@ -1249,8 +1642,13 @@ static bool sound_UpdateStream(AUDIO_STREAM *stream)
 		alSourceUnqueueBuffers(stream->source, 1, &buffer);
 		sound_GetError();
 
-		// Decode some data to stuff in our buffer
-		soundBuffer = sound_DecodeOggVorbis(stream->decoder, stream->bufferSize);
+		// Decode some data to stuff in our buffer, if it wasn't decoded ahead already
+		soundBuffer = stream->decodedAhead;
+		stream->decodedAhead = nullptr;
+		if (soundBuffer == nullptr && !stream->endOfStream)
+		{
+			soundBuffer = sound_DecodeTimed(stream->decoder, stream->bufferSize);
+		}
 
 		// If we actually decoded some data
 		if (soundBuffer && soundBuffer->size > 0)
@@ -1271,6 +1669,7 @@ static bool sound_UpdateStream(AUDIO_STREAM *stream)
 		{
 			// If no data has been decoded we're probably at the end of our
 			// stream. So cleanup this buffer.
+			stream->endOfStream = true;
 
 			// Then remove OpenAL's buffer
 			alDeleteBuffers(1, &buffer);
@@ -1281,6 +1680,14 @@ static bool sound_UpdateStream(AUDIO_STREAM *stream)
 		free(soundBuffer);
 	}
 
+	if (underrun)
+	{
+		alSourcePlay(stream->source);
+		sound_GetError();
+	}
+
+	sound_DecodeAhead(stream);
+
 	return true;
 }
 
@@ -1355,6 +1762,7 @@ static void sound_DestroyStream(AUDIO_STREAM *stream)
 	sound_GetError();
 
 	// Destroy the sound decoder
+	free(stream->decodedAhead);
 	sound_DestroyOggVorbisDecoder(stream->decoder);
 
 	// Now close the file
@@ -1376,6 +1784,8 @@ static void sound_UpdateStreams()
 {
 	AUDIO_STREAM *stream = active_streams, *previous = nullptr, *next = nullptr;
 
+	sound_WaitForDecodeAhead();
+
 	while (stream != nullptr)
 	{
 		next = stream->next;
@@ -1419,6 +1829,12 @@ static void sound_UpdateStreams()
 //
 void sound_StopSample(AUDIO_SAMPLE *psSample)
 {
+	if (psSample->bVirtual)
+	{
+		// No source to stop; sound_Update() removes it
+		psSample->bVirtual = false;
+		return;
+	}
 	if (psSample->iSample == (ALuint)SAMPLE_NOT_ALLOCATED)
 	{
 		debug(LOG_SOUND, "sound_StopSample: sample number (%u) out of range, we probably have run out of available OpenAL sources", psSample->iSample);
@@ -1432,6 +1848,7 @@ void sound_StopSample(AUDIO_SAMPLE *psSample)
 
 void sound_SetPlayerPos(Vector3f pos)
 {
+	listenerPos = pos;
 	alListener3f(AL_POSITION, pos.x, pos.y, pos.z);
 	sound_GetError();
 }
@@ -1485,8 +1902,8 @@ void sound_SetObjectPosition(AUDIO_SAMPLE *psSample)
 	float	distance, gain;
 	//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-	// only set it when we have a valid sample
-	if (!psSample)
+	// only set it when we have a valid sample, with a source (virtual voices have none)
+	if (!psSample || psSample->iSample == (ALuint)AL_INVALID)
 	{
 		return;
 	}
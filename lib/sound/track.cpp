@@ -133,7 +133,7 @@ unsigned int sound_SetTrackVals(const char *fileName, bool loop, unsigned int vo
 	psTrack->iAudibleRadius = audibleRadius;
 
 	// RAII: Make sure to initialize all values (we don't want undefined values)!
-	psTrack->iTime = 0;
+	// (iTime is the duration, which was set when the track was decoded)
 	psTrack->iTimeLastFinished = 0;
 	psTrack->iNumPlaying = 0;
 
@@ -58,6 +58,8 @@ struct AUDIO_SAMPLE
 	SDWORD                  x, y, z;
 	float                   fVol;           // computed volume of sample
 	bool                    bFinishedPlaying;
+	bool                    bVirtual;       // 3D sample that lost its voice to more important ones, and plays on silently without an OpenAL source
+	UDWORD                  iStartTime;     // real time the sample started playing
 	AUDIO_CALLBACK          pCallback;
 	SIMPLE_OBJECT          *psObj;
 	AUDIO_SAMPLE           *psPrev;
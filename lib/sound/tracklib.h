@@ -72,4 +72,26 @@ unsigned int sound_GetActiveSamplesCount();
 
 UDWORD	sound_GetGameTime();
 
+struct AudioDecodeStats
+{
+	uint64_t decodeMicroseconds = 0;  ///< Time spent decoding, on any thread
+	size_t trackCacheHits = 0;        ///< Tracks loaded from already decoded data
+	size_t trackCacheMisses = 0;      ///< Tracks that had to be decoded
+	size_t trackCacheBytes = 0;       ///< Decoded data currently cached
+	size_t streamUnderruns = 0;       ///< Times a stream ran dry before it could be refilled
+};
+AudioDecodeStats sound_GetDecodeStats();
+
+struct AudioVoiceStats
+{
+	size_t voices = 0;         ///< 3D samples currently playing through an OpenAL source
+	size_t virtualVoices = 0;  ///< 3D samples currently playing on silently, waiting for a voice
+	size_t budget = 0;         ///< Most 3D samples that play through a source at once
+	size_t started = 0;        ///< 3D samples started
+	size_t virtualised = 0;    ///< 3D samples that started out virtual
+	size_t stolen = 0;         ///< Voices taken from playing samples by more important ones
+	size_t revived = 0;        ///< Virtual samples that got a voice again
+};
+AudioVoiceStats sound_GetVoiceStats();
+
 #endif	// __INCLUDED_LIB_SOUND_TRACKLIB_H__
@@ -80,6 +80,7 @@ typedef struct _poptContext
 static bool wz_autogame = false;
 static std::string wz_saveandquit;
 static std::string wz_test;
+static std::string wz_replayFile;
 static std::string wz_autoratingUrl;
 static bool wz_cli_headless = false;
 
@@ -323,6 +324,7 @@ typedef enum
 	CLI_AUTOHOST,
 	CLI_AUTORATING,
 	CLI_AUTOHEADLESS,
+	CLI_REPLAY,
 #if defined(WZ_OS_WIN)
 	CLI_WIN_ENABLE_CONSOLE,
 #endif
@@ -376,7 +378,8 @@ static const struct poptOption *getOptionsTable()
 					")"
 		},
 		{ "autogame", POPT_ARG_NONE, CLI_AUTOGAME,   N_("Run games automatically for testing"), nullptr },
-		{ "headless", POPT_ARG_NONE, CLI_AUTOHEADLESS,   N_("Headless mode (only supported when also specifying --autogame, --autohost, --skirmish)"), nullptr },
+		{ "headless", POPT_ARG_NONE, CLI_AUTOHEADLESS,   N_("Headless mode (only supported when also specifying --autogame, --autohost, --skirmish, --replay)"), nullptr },
+		{ "replay", POPT_ARG_STRING, CLI_REPLAY,   N_("Play back a recorded game, at maximum speed if headless"), N_("replay file") },
 		{ "saveandquit", POPT_ARG_STRING, CLI_SAVEANDQUIT, N_("Immediately save game and quit"), N_("save name") },
 		{ "skirmish", POPT_ARG_STRING, CLI_SKIRMISH,   N_("Start skirmish game with given settings file"), N_("test") },
 		{ "continue", POPT_ARG_NONE, CLI_CONTINUE,   N_("Continue the last saved game"), nullptr },
@@ -839,6 +842,16 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			setHeadlessGameMode(true);
 			break;
 
+		case CLI_REPLAY:
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr)
+			{
+				qFatal("Bad replay file");
+			}
+			wz_replayFile = token;
+			setHostLaunch(HostLaunch::Skirmish);  // A replay sets up a skirmish game, but takes all orders from the recording.
+			break;
+
 		case CLI_GAMEPORT:
 			token = poptGetOptArg(poptCon);
 			if (token == nullptr)
@@ -870,6 +883,11 @@ const std::string &wz_skirmish_test()
 	return wz_test;
 }
 
+const std::string &wz_replay()
+{
+	return wz_replayFile;
+}
+
 std::string autoratingUrl(std::string const &hash) {
 	auto url = wz_autoratingUrl;
 	auto h = wz_autoratingUrl.find_first_of("{HASH}");
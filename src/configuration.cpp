@@ -25,6 +25,7 @@
 
 #include "lib/framework/wzconfig.h"
 #include "lib/framework/input.h"
+#include "lib/framework/file.h"
 #include "lib/netplay/netplay.h"
 #include "lib/sound/mixer.h"
 #include "lib/sound/sounddefs.h"
@@ -357,6 +358,9 @@ bool loadConfig()
 		NETsetGameserverPort(iniGetInteger("gameserver_port", GAMESERVERPORT).value());
 	}
 	NETsetJoinPreferenceIPv6(iniGetBool("prefer_ipv6", true).value());
+	NETsetCompressionLevel(iniGetInteger("netCompressionLevel", 6).value());
+	NETsetCompressionStrategy(iniGetString("netCompressionStrategy", "default").value());
+	NETsetAdaptiveCompression(iniGetBool("netCompressionAdaptive", false).value());
 	setPublicIPv4LookupService(iniGetString("publicIPv4LookupService_Url", WZ_DEFAULT_PUBLIC_IPv4_LOOKUP_SERVICE_URL).value(), iniGetString("publicIPv4LookupService_JSONKey", WZ_DEFAULT_PUBLIC_IPv4_LOOKUP_SERVICE_JSONKEY).value());
 	setPublicIPv6LookupService(iniGetString("publicIPv6LookupService_Url", WZ_DEFAULT_PUBLIC_IPv6_LOOKUP_SERVICE_URL).value(), iniGetString("publicIPv6LookupService_JSONKey", WZ_DEFAULT_PUBLIC_IPv6_LOOKUP_SERVICE_JSONKEY).value());
 	war_SetFMVmode((FMV_MODE)iniGetInteger("FMVmode", FMV_FULLSCREEN).value());
@@ -461,6 +465,11 @@ bool loadConfig()
 			debug(LOG_WARNING, "Unsupported / invalid jsbackend value: %s; defaulting to: %s", jsbackendStr.c_str(), to_string(js_backend).c_str());
 		}
 	}
+	war_setBackgroundScriptStateSave(iniGetBool("backgroundScriptStateSave", false).value());
+	war_setRecordReplays(iniGetBool("recordReplays", false).value());
+	war_setBinarySaves(iniGetBool("binarySaves", false).value());
+	war_setAssetCacheMiB(iniGetInteger("assetCacheMiB", 0).value());
+	setAssetCacheLimit(static_cast<size_t>(war_getAssetCacheMiB()) * 1024 * 1024);
 	BlueprintTrackAnimationSpeed = iniGetInteger("BlueprintTrackAnimationSpeed", 20).value();
 	lockCameraScrollWhileRotating = iniGetBool("lockCameraScrollWhileRotating", false).value();
 	ActivityManager::instance().endLoadingSettings();
@@ -567,6 +576,9 @@ bool saveConfig()
 		iniSetInteger("gameserver_port", (int)NETgetGameserverPort());
 	}
 	iniSetBool("prefer_ipv6", NETgetJoinPreferenceIPv6());
+	iniSetInteger("netCompressionLevel", NETgetCompressionLevel());
+	iniSetString("netCompressionStrategy", NETgetCompressionStrategy());
+	iniSetBool("netCompressionAdaptive", NETgetAdaptiveCompression());
 	iniSetString("publicIPv4LookupService_Url", getPublicIPv4LookupServiceUrl());
 	iniSetString("publicIPv4LookupService_JSONKey", getPublicIPv4LookupServiceJSONKey());
 	iniSetString("publicIPv6LookupService_Url", getPublicIPv6LookupServiceUrl());
@@ -597,6 +609,10 @@ bool saveConfig()
 	iniSetString("favoriteStructs", getFavoriteStructs().toUtf8());
 	iniSetString("gfxbackend", to_string(war_getGfxBackend()));
 	iniSetString("jsbackend", to_string(war_getJSBackend()));
+	iniSetBool("backgroundScriptStateSave", war_getBackgroundScriptStateSave());
+	iniSetBool("recordReplays", war_getRecordReplays());
+	iniSetBool("binarySaves", war_getBinarySaves());
+	iniSetInteger("assetCacheMiB", war_getAssetCacheMiB());
 	iniSetInteger("BlueprintTrackAnimationSpeed", BlueprintTrackAnimationSpeed);
 	iniSetBool("lockCameraScrollWhileRotating", lockCameraScrollWhileRotating);
 
@@ -668,38 +668,39 @@ struct RES_TYPE_MIN_FILE
 	const char *aType;                      ///< points to the string defining the type (e.g. SCRIPT) - NULL indicates end of list
 	RES_FILELOAD fileLoad;                  ///< routine to process the data for this type
 	RES_FREE release;                       ///< routine to release the data (NULL indicates none)
+	bool readAhead;                         ///< fileLoad reads the file with loadFile() (see resAddFileLoad)
 };
 
 static const RES_TYPE_MIN_FILE FileResourceTypes[] =
 {
-	{"SFEAT", bufferSFEATLoad, dataSFEATRelease},                  //feature stats file
-	{"STEMPL", bufferSTEMPLLoad, dataSTEMPLRelease},               //template and associated files
-	{"WAV", dataAudioLoad, (RES_FREE)sound_ReleaseTrack},
-	{"SWEAPON", bufferSWEAPONLoad, dataReleaseStats},
-	{"SBPIMD", bufferSBPIMDLoad, dataReleaseStats},
-	{"SBRAIN", bufferSBRAINLoad, dataReleaseStats},
-	{"SSENSOR", bufferSSENSORLoad, dataReleaseStats},
-	{"SECM", bufferSECMLoad, dataReleaseStats},
-	{"SREPAIR", bufferSREPAIRLoad, dataReleaseStats},
-	{"SCONSTR", bufferSCONSTRLoad, dataReleaseStats},
-	{"SPROP", bufferSPROPLoad, dataReleaseStats},
-	{"SPROPTYPES", bufferSPROPTYPESLoad, dataReleaseStats},
-	{"STERRTABLE", bufferSTERRTABLELoad, dataReleaseStats},
-	{"SBODY", bufferSBODYLoad, dataReleaseStats},
-	{"SWEAPMOD", bufferSWEAPMODLoad, dataReleaseStats},
-	{"SPROPSND", bufferSPROPSNDLoad, dataReleaseStats},
-	{"AUDIOCFG", dataAudioCfgLoad, nullptr},
-	{"IMGPAGE", dataImageLoad, dataImageRelease},
-	{"TERTILES", dataTERTILESLoad, nullptr},
-	{"IMG", dataIMGLoad, dataIMGRelease},
-	{"TEXPAGE", nullptr, nullptr}, // ignored
-	{"TCMASK", nullptr, nullptr}, // ignored
-	{"STR_RES", dataStrResLoad, dataStrResRelease},
-	{"RESEARCHMSG", dataResearchMsgLoad, dataSMSGRelease },
-	{"SSTRMOD", bufferSSTRMODLoad, nullptr},
-	{"JAVASCRIPT", jsLoad, nullptr},
-	{"SSTRUCT", bufferSSTRUCTLoad, dataSSTRUCTRelease},            //structure stats and associated files
-	{"RESCH", bufferRESCHLoad, dataRESCHRelease},                  //research stats files
+	{"SFEAT", bufferSFEATLoad, dataSFEATRelease, true},                  //feature stats file
+	{"STEMPL", bufferSTEMPLLoad, dataSTEMPLRelease, true},               //template and associated files
+	{"WAV", dataAudioLoad, (RES_FREE)sound_ReleaseTrack, false},
+	{"SWEAPON", bufferSWEAPONLoad, dataReleaseStats, true},
+	{"SBPIMD", bufferSBPIMDLoad, dataReleaseStats, false},
+	{"SBRAIN", bufferSBRAINLoad, dataReleaseStats, true},
+	{"SSENSOR", bufferSSENSORLoad, dataReleaseStats, true},
+	{"SECM", bufferSECMLoad, dataReleaseStats, true},
+	{"SREPAIR", bufferSREPAIRLoad, dataReleaseStats, true},
+	{"SCONSTR", bufferSCONSTRLoad, dataReleaseStats, true},
+	{"SPROP", bufferSPROPLoad, dataReleaseStats, true},
+	{"SPROPTYPES", bufferSPROPTYPESLoad, dataReleaseStats, true},
+	{"STERRTABLE", bufferSTERRTABLELoad, dataReleaseStats, true},
+	{"SBODY", bufferSBODYLoad, dataReleaseStats, true},
+	{"SWEAPMOD", bufferSWEAPMODLoad, dataReleaseStats, true},
+	{"SPROPSND", bufferSPROPSNDLoad, dataReleaseStats, true},
+	{"AUDIOCFG", dataAudioCfgLoad, nullptr, false},
+	{"IMGPAGE", dataImageLoad, dataImageRelease, false},
+	{"TERTILES", dataTERTILESLoad, nullptr, false},
+	{"IMG", dataIMGLoad, dataIMGRelease, true},
+	{"TEXPAGE", nullptr, nullptr, false}, // ignored
+	{"TCMASK", nullptr, nullptr, false}, // ignored
+	{"STR_RES", dataStrResLoad, dataStrResRelease, false},
+	{"RESEARCHMSG", dataResearchMsgLoad, dataSMSGRelease, true},
+	{"SSTRMOD", bufferSSTRMODLoad, nullptr, true},
+	{"JAVASCRIPT", jsLoad, nullptr, true},
+	{"SSTRUCT", bufferSSTRUCTLoad, dataSSTRUCTRelease, true},            //structure stats and associated files
+	{"RESCH", bufferRESCHLoad, dataRESCHRelease, true},                  //research stats files
 };
 
 /* Pass all the data loading functions to the framework library */
@@ -729,11 +730,11 @@ bool dataInitLoadFuncs()
 	{
 		const RES_TYPE_MIN_FILE *CurrentType;
 		// Points just past the last item in the list
-		const RES_TYPE_MIN_FILE *const EndType = &FileResourceTypes[sizeof(FileResourceTypes) / sizeof(RES_TYPE_MIN_BUF)];
+		const RES_TYPE_MIN_FILE *const EndType = &FileResourceTypes[sizeof(FileResourceTypes) / sizeof(RES_TYPE_MIN_FILE)];
 
 		for (CurrentType = FileResourceTypes; CurrentType != EndType; ++CurrentType)
 		{
-			if (!resAddFileLoad(CurrentType->aType, CurrentType->fileLoad, CurrentType->release))
+			if (!resAddFileLoad(CurrentType->aType, CurrentType->fileLoad, CurrentType->release, CurrentType->readAhead))
 			{
 				return false; // error whilst adding a file load
 			}
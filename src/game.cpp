@@ -87,9 +87,12 @@
 #include "lib/ivis_opengl/screen.h"
 #include "keymap.h"
 #include <ctime>
+#include <atomic>
+#include "lib/framework/wzthreadpool.h"
 #include "multimenu.h"
 #include "console.h"
 #include "wzscriptdebug.h"
+#include "notifications.h"
 
 #if defined(__clang__)
 #pragma clang diagnostic ignored "-Wcast-align"	// TODO: FIXME!
@@ -1607,6 +1610,12 @@ static UDWORD		width, height;
 static GAME_TYPE	gameType;
 static bool IsScenario;
 
+/// The format for the bulky savegame files (objects, research, ...). main.json and gameinfo.json always stay text, since they're small and read when listing savegames.
+static JsonFileFormat saveFileFormat()
+{
+	return war_getBinarySaves() ? JSON_FILE_BINARY : JSON_FILE_TEXT;
+}
+
 /***************************************************************************/
 /*
  *	Local ProtoTypes
@@ -1679,6 +1688,8 @@ so can be called in levLoadData when starting a game from a load save game*/
 // -----------------------------------------------------------------------------------------
 bool loadGameInit(const char *fileName)
 {
+	waitForBackgroundSave();  // Don't read a savegame that is still being written.
+
 	if (!gameLoad(fileName))
 	{
 		debug(LOG_ERROR, "Corrupted / unsupported savegame file %s, Unable to load!", fileName);
@@ -1860,6 +1871,8 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 	UWORD           missionScrollMinX = 0, missionScrollMinY = 0,
 	                missionScrollMaxX = 0, missionScrollMaxY = 0;
 
+	waitForBackgroundSave();
+
 	/* Stop the game clock */
 	gameTimeStop();
 
@@ -2067,6 +2080,24 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 	aFileName[fileExten - 1] = '\0';
 	strcat(aFileName, "/");
 
+	// The sections are independent until they are applied, so parse them all up front in parallel.
+	// They are still applied one at a time below, in the same order as before.
+	{
+		static const char *const sectionFiles[] =
+		{
+			"templates.json", "mfeature.json", "mstruct.json", "mdroid.json", "fxstate.json", "resstate.json",
+			"droid.json", "limbo.json", "feature.json", "struct.json", "complist.json", "strtype.json",
+			"score.json", "firesupport.json", "limits.json", "labels.json", "messtate.json",
+		};
+		std::vector<std::string> fileNames;
+		for (const char *sectionFile : sectionFiles)
+		{
+			fileNames.push_back(std::string(aFileName, fileExten) + sectionFile);
+		}
+		WzThreadPool pool(WzThreadPool::defaultWorkerThreadCount());
+		preparseJsonFiles(fileNames, pool);
+	}
+
 	//the terrain type WILL only change with Campaign changes (well at the moment!)
 	if (gameType != GTYPE_SCENARIO_EXPAND || UserSaveGame)
 	{
@@ -2133,6 +2164,7 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 		if (!mapLoad(aFileName, false))
 		{
 			debug(LOG_ERROR, "Failed with: %s", aFileName);
+			clearPreparsedJsonFiles();
 			return false;
 		}
 
@@ -2263,6 +2295,7 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 		if (haveScript? !mapLoadFromScriptData(data, false) : !mapLoad(aFileName, false))
 		{
 			debug(LOG_ERROR, "Failed with: %s", aFileName);
+			clearPreparsedJsonFiles();
 			return false;
 		}
 	}
@@ -2653,11 +2686,13 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 
 	debug(LOG_NEVER, "Done loading");
 
+	clearPreparsedJsonFiles();
 	return true;
 
 error:
 	debug(LOG_ERROR, "Game load failed for %s, FS:%s, params=%s,%s,%s", pGameToLoad, WZ_PHYSFS_getRealDir_String(pGameToLoad).c_str(),
 	      keepObjects ? "true" : "false", freeMem ? "true" : "false", UserSaveGame ? "true" : "false");
+	clearPreparsedJsonFiles();
 
 	/* Clear all the objects off the map and free up the map memory */
 	freeAllDroids();
@@ -2673,12 +2708,82 @@ error:
 }
 // -----------------------------------------------------------------------------------------
 
-bool saveGame(const char *aFileName, GAME_TYPE saveType)
+struct BackgroundSave
+{
+	std::string saveName;
+	std::function<void (bool ok)> onWritten;
+	std::atomic<bool> ok{false};
+};
+
+static WzThreadPool *saveWriter = nullptr;              ///< Writes the files of background saves.
+static std::atomic<bool> saveWriterBusy(false);
+static std::shared_ptr<BackgroundSave> unreportedSave;  ///< Background save that has not been reported yet. Only used on the main thread.
+
+bool isBackgroundSaveInProgress()
+{
+	return saveWriterBusy;
+}
+
+/// Reports a background save once its files are written, on the main thread.
+static void reportBackgroundSave()
+{
+	if (!unreportedSave || saveWriterBusy)
+	{
+		return;
+	}
+	std::shared_ptr<BackgroundSave> save = std::move(unreportedSave);
+	unreportedSave.reset();
+
+	// Even after a failure, since scripts may pause from TRIGGER_GAME_SAVING until this. Failures are shown in the notification.
+	triggerEvent(TRIGGER_GAME_SAVED);
+	WZ_Notification notification;
+	notification.duration = 4 * GAME_TICKS_PER_SEC;
+	notification.contentTitle = save->ok ? _("Game saved") : _("Saving the game failed");
+	notification.contentText = save->saveName;
+	notification.tag = "background_save";
+	addNotification(notification, WZ_Notification_Trigger::Immediate());
+	if (save->onWritten)
+	{
+		save->onWritten(save->ok);
+	}
+}
+
+void waitForBackgroundSave()
+{
+	if (saveWriter)
+	{
+		saveWriter->waitForAll();
+	}
+	// Report it now, while the game it belongs to is still loaded.
+	reportBackgroundSave();
+}
+
+/// Writes the files that saveGame() snapshotted, on the worker thread, and has the save reported on the main thread.
+static void writeBackgroundSave(std::shared_ptr<BackgroundSave> save, std::shared_ptr<std::vector<DeferredJsonFile>> files)
+{
+	bool ok = true;
+	for (DeferredJsonFile const &file : *files)
+	{
+		ok = saveJsonFile(file.fileName.c_str(), file.root, file.format) && ok;
+	}
+	files->clear();  // Free the snapshot on this thread too.
+	save->ok = ok;
+	saveWriterBusy = false;
+
+	wzAsyncExecOnMainThread([]() {
+		reportBackgroundSave();  // Unless waitForBackgroundSave() already did.
+	});
+}
+
+bool saveGame(const char *aFileName, GAME_TYPE saveType, bool background, std::function<void (bool ok)> onWritten)
 {
 	size_t			fileExtension;
 	DROID			*psDroid, *psNext;
 	char			CurrentFileName[PATH_MAX] = {'\0'};
 
+	// A previous background save may still be writing (and should be reported before this one starts).
+	waitForBackgroundSave();
+
 	triggerEvent(TRIGGER_GAME_SAVING);
 
 	ASSERT_OR_RETURN(false, aFileName && strlen(aFileName) > 4, "Bad savegame filename");
@@ -2689,6 +2794,12 @@ bool saveGame(const char *aFileName, GAME_TYPE saveType)
 	gameTimeStop();
 	sanityUpdate();
 
+	if (background)
+	{
+		// Everything that goes through saveJsonFile() is just snapshotted during the save, and written out afterwards.
+		saveJsonFilesDeferredBegin();
+	}
+
 	/* Write the data to the file */
 	if (!writeGameFile(CurrentFileName, saveType))
 	{
@@ -2960,12 +3071,37 @@ bool saveGame(const char *aFileName, GAME_TYPE saveType)
 	// strip the last filename
 	CurrentFileName[fileExtension - 1] = '\0';
 
+	if (background)
+	{
+		auto files = std::make_shared<std::vector<DeferredJsonFile>>(saveJsonFilesDeferredEnd());
+		if (!saveWriter)
+		{
+			saveWriter = new WzThreadPool(1);
+		}
+		saveWriterBusy = true;
+		std::shared_ptr<BackgroundSave> save = std::make_shared<BackgroundSave>();
+		save->saveName = aFileName;
+		save->onWritten = std::move(onWritten);
+		unreportedSave = save;
+		saveWriter->addJob([save, files]() {
+			writeBackgroundSave(save, files);
+		});
+	}
+	else
+	{
+		triggerEvent(TRIGGER_GAME_SAVED);
+	}
+
 	/* Start the game clock */
-	triggerEvent(TRIGGER_GAME_SAVED);
 	gameTimeStart();
 	return true;
 
 error:
+	if (background)
+	{
+		saveJsonFilesDeferredEnd();  // Drop the half-finished snapshot.
+	}
+
 	/* Start the game clock */
 	gameTimeStart();
 
@@ -5021,10 +5157,7 @@ static bool writeDroidFile(const char *pFileName, DROID **ppsCurrentDroidLists)
 		}
 	}
 
-	std::ostringstream stream;
-	stream << mRoot.dump(4) << std::endl;
-	std::string jsonString = stream.str();
-	saveFile(pFileName, jsonString.c_str(), jsonString.size());
+	saveJsonFile(pFileName, std::move(mRoot), saveFileFormat());
 	debug(LOG_SAVE, "%s %s", "Saving", pFileName);
 
 	return true;
@@ -5567,6 +5700,7 @@ Writes the linked list of structure for each player to a file
 bool writeStructFile(const char *pFileName)
 {
 	WzConfig ini(WzString::fromUtf8(pFileName), WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 	int counter = 0;
 
 	for (int player = 0; player < MAX_PLAYERS; player++)
@@ -6027,6 +6161,7 @@ Writes the linked list of features to a file
 bool writeFeatureFile(const char *pFileName)
 {
 	WzConfig ini(WzString::fromUtf8(pFileName), WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 	int counter = 0;
 
 	for (FEATURE *psCurr = apsFeatureLists[0]; psCurr != nullptr; psCurr = psCurr->psNext)
@@ -6102,6 +6237,7 @@ bool loadSaveTemplate(const char *pFileName)
 bool writeTemplateFile(const char *pFileName)
 {
 	WzConfig ini(pFileName, WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 
 	auto writeTemplate = [&](DROID_TEMPLATE *psCurr) {
 		saveTemplateCommon(ini, psCurr);
@@ -6352,6 +6488,7 @@ bool loadSaveCompList(const char *pFileName)
 static bool writeCompListFile(const char *pFileName)
 {
 	WzConfig ini(WzString::fromUtf8(pFileName), WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 
 	// Save each type of struct type
 	for (int player = 0; player < MAX_PLAYERS; player++)
@@ -6474,6 +6611,7 @@ static bool loadSaveStructTypeList(const char *pFileName)
 static bool writeStructTypeListFile(const char *pFileName)
 {
 	WzConfig ini(pFileName, WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 
 	// Save each type of struct type
 	for (int player = 0; player < MAX_PLAYERS; player++)
@@ -6558,6 +6696,7 @@ bool loadSaveResearch(const char *pFileName)
 static bool writeResearchFile(char *pFileName)
 {
 	WzConfig ini(WzString::fromUtf8(pFileName), WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 
 	for (size_t i = 0; i < asResearch.size(); ++i)
 	{
@@ -6724,6 +6863,7 @@ bool loadSaveMessage(const char* pFileName, LEVEL_TYPE levelType)
 static bool writeMessageFile(const char *pFileName)
 {
 	WzConfig ini(pFileName, WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 	int numMessages = 0;
 
 	// save each type of research
@@ -6845,6 +6985,7 @@ Writes the list of structure limits to a file
 bool writeStructLimitsFile(const char *pFileName)
 {
 	WzConfig ini(pFileName, WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 
 	// Save each type of struct type
 	for (int player = 0; player < game.maxPlayers; player++)
@@ -6895,6 +7036,7 @@ bool writeFiresupportDesignators(const char *pFileName)
 {
 	int player;
 	WzConfig ini(pFileName, WzConfig::ReadAndWrite);
+	ini.setFileFormat(saveFileFormat());
 
 	for (player = 0; player < MAX_PLAYERS; player++)
 	{
@@ -6919,9 +7061,7 @@ static bool	writeScriptState(const char *pFileName)
 	ext = strrchr(jsFilename, '/');
 	*ext = '\0';
 	strcat(jsFilename, "/scriptstate.json");
-	saveScriptStates(jsFilename);
-
-	return true;
+	return saveScriptStates(jsFilename);
 }
 
 // -----------------------------------------------------------------------------------------
@@ -33,6 +33,8 @@
 #include "gamedef.h"
 #include "levels.h"
 
+#include <functional>
+
 /***************************************************************************/
 /*
  *	Global ProtoTypes
@@ -54,7 +56,11 @@ bool loadScriptState(char *pFileName);
 bool loadTerrainTypeMap(char *pFileData, UDWORD filesize);
 bool loadTerrainTypeMapOverride(unsigned int tileSet);
 
-bool saveGame(const char *aFileName, GAME_TYPE saveType);
+/// Saves the game. If background is set, the game state is snapshotted now, but most files are written on a worker thread after returning.
+/// A background save fires TRIGGER_GAME_SAVED (even if writing failed), and calls onWritten with whether it succeeded, on the main thread once writing has finished.
+bool saveGame(const char *aFileName, GAME_TYPE saveType, bool background = false, std::function<void (bool ok)> onWritten = nullptr);
+bool isBackgroundSaveInProgress();  ///< True while a background save is still writing files.
+void waitForBackgroundSave();       ///< Waits until a background save has finished writing, and reports it. Call before touching savegame files.
 
 // Get the campaign number for loadGameInit game
 UDWORD getCampaign(const char *fileName);
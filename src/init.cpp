@@ -31,6 +31,7 @@
 #include "lib/framework/file.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzapp.h"
+#include "lib/framework/wzconfig.h"
 #include "lib/ivis_opengl/piemode.h"
 #include "lib/ivis_opengl/piestate.h"
 #include "lib/ivis_opengl/screen.h"
@@ -38,6 +39,7 @@
 #include "lib/ivis_opengl/tex.h"
 #include "lib/ivis_opengl/imd.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
 #include "lib/sound/audio_id.h"
 #include "lib/sound/cdaudio.h"
 #include "lib/sound/mixer.h"
@@ -480,7 +482,101 @@ public:
 	std::string platformDependent;
 };
 typedef std::vector<MapFileListPath> MapFileList;
-static MapFileList listMapFiles()
+
+// What buildMapList() found in a map archive, so that it only needs to be mounted again once it changes.
+struct MapArchiveInfo
+{
+	std::string realDir;
+	PHYSFS_sint64 size = -1;
+	PHYSFS_sint64 modtime = -1;
+	bool isMapPack = false;  ///< Not added to the map list at all.
+	bool scanned = false;    ///< Whether the fields below are known.
+	bool isMapMod = false;
+	bool isRandom = false;
+	std::vector<std::pair<std::string, std::string>> levFiles;  ///< Name and contents of each .lev file in the archive.
+};
+typedef std::unordered_map<std::string, MapArchiveInfo> MapArchiveIndex;
+
+#define MAP_ARCHIVE_INDEX_FILE "cache/maplist.json"
+#define MAP_ARCHIVE_INDEX_VERSION 1
+
+static MapArchiveIndex loadMapArchiveIndex()
+{
+	MapArchiveIndex index;
+	char *data = nullptr;
+	UDWORD size = 0;
+	if (!PHYSFS_exists(MAP_ARCHIVE_INDEX_FILE) || !loadFile(MAP_ARCHIVE_INDEX_FILE, &data, &size))
+	{
+		return index;
+	}
+	try {
+		nlohmann::json root = parseJsonFile(data, size);
+		if (root.value("version", 0) == MAP_ARCHIVE_INDEX_VERSION)
+		{
+			for (auto it = root.at("maps").begin(); it != root.at("maps").end(); ++it)
+			{
+				nlohmann::json const &map = it.value();
+				MapArchiveInfo &info = index[it.key()];
+				info.realDir = map.at("realDir").get<std::string>();
+				info.size = map.at("size").get<PHYSFS_sint64>();
+				info.modtime = map.at("modtime").get<PHYSFS_sint64>();
+				info.isMapPack = map.at("mapPack").get<bool>();
+				info.scanned = !info.isMapPack;
+				info.isMapMod = map.value("mapMod", false);
+				info.isRandom = map.value("random", false);
+				for (nlohmann::json const &lev : map.value("lev", nlohmann::json::array()))
+				{
+					info.levFiles.emplace_back(lev.at("name").get<std::string>(), lev.at("text").get<std::string>());
+				}
+			}
+		}
+	}
+	catch (const std::exception &e) {
+		debug(LOG_WARNING, "Ignoring invalid %s: %s", MAP_ARCHIVE_INDEX_FILE, e.what());
+		index.clear();
+	}
+	free(data);
+	return index;
+}
+
+static void saveMapArchiveIndex(MapArchiveIndex const &index)
+{
+	nlohmann::json maps = nlohmann::json::object();
+	for (auto const &entry : index)
+	{
+		MapArchiveInfo const &info = entry.second;
+		if (!info.isMapPack && !info.scanned)
+		{
+			continue;
+		}
+		nlohmann::json map = nlohmann::json::object();
+		map["realDir"] = info.realDir;
+		map["size"] = info.size;
+		map["modtime"] = info.modtime;
+		map["mapPack"] = info.isMapPack;
+		map["mapMod"] = info.isMapMod;
+		map["random"] = info.isRandom;
+		nlohmann::json levFiles = nlohmann::json::array();
+		for (auto const &levFile : info.levFiles)
+		{
+			levFiles.push_back(nlohmann::json{{"name", levFile.first}, {"text", levFile.second}});
+		}
+		map["lev"] = std::move(levFiles);
+		maps[entry.first] = std::move(map);
+	}
+	nlohmann::json root = nlohmann::json::object();
+	root["version"] = MAP_ARCHIVE_INDEX_VERSION;
+	root["maps"] = std::move(maps);
+	saveJsonFile(MAP_ARCHIVE_INDEX_FILE, root, JSON_FILE_BINARY);
+}
+
+// Whether the archive is where, and as big and as old as, it was when its index entry was made.
+static bool mapArchiveUnchanged(MapArchiveInfo const &info, std::string const &realDir, PHYSFS_Stat const &metaData)
+{
+	return info.realDir == realDir && info.size == metaData.filesize && info.modtime == metaData.modtime && (info.isMapPack || info.scanned);
+}
+
+static MapFileList listMapFiles(MapArchiveIndex &index, MapArchiveIndex const &oldIndex)
 {
 	MapFileList ret, filtered;
 	std::vector<std::string> oldSearchPath;
@@ -494,10 +590,36 @@ static MapFileList listMapFiles()
 
 		std::string realFileName_platformIndependent = std::string("maps") + "/" + i;
 		std::string realFileName_platformDependent = std::string("maps") + PHYSFS_getDirSeparator() + i;
+
+		// Only archives that are new or changed need to be mounted to be checked.
+		const char *realDir = PHYSFS_getRealDir(realFileName_platformIndependent.c_str());
+		PHYSFS_Stat metaData;
+		if (realDir != nullptr && PHYSFS_stat(realFileName_platformIndependent.c_str(), &metaData))
+		{
+			auto old = oldIndex.find(realFileName_platformIndependent);
+			if (old != oldIndex.end() && mapArchiveUnchanged(old->second, realDir, metaData))
+			{
+				index[realFileName_platformIndependent] = old->second;
+				if (!old->second.isMapPack)
+				{
+					filtered.push_back(MapFileListPath(realFileName_platformIndependent, realFileName_platformDependent));
+				}
+				return true; // continue
+			}
+			MapArchiveInfo &info = index[realFileName_platformIndependent];
+			info.realDir = realDir;
+			info.size = metaData.filesize;
+			info.modtime = metaData.modtime;
+		}
 		ret.push_back(MapFileListPath(realFileName_platformIndependent, realFileName_platformDependent));
 		return true; // continue
 	});
 
+	if (ret.empty())
+	{
+		return filtered;
+	}
+
 	// save our current search path(s)
 	debug(LOG_WZ, "Map search paths:");
 	char **searchPath = PHYSFS_getSearchPath();
@@ -537,6 +659,11 @@ static MapFileList listMapFiles()
 			{
 				filtered.push_back(realFileName);
 			}
+			auto info = index.find(realFileName.platformIndependent);
+			if (info != index.end())
+			{
+				info->second.isMapPack = unsafe >= 2;
+			}
 			WZ_PHYSFS_unmount(realFilePathAndName.c_str());
 		}
 		else
@@ -671,11 +798,37 @@ bool buildMapList()
 	}
 	loadLevFile("addon.lev", mod_multiplay, false, nullptr);
 	WZ_Maps.clear();
-	MapFileList realFileNames = listMapFiles();
+	static MapArchiveIndex mapArchiveIndex = loadMapArchiveIndex();
+	MapArchiveIndex oldMapArchiveIndex = std::move(mapArchiveIndex);
+	mapArchiveIndex.clear();
+	MapFileList realFileNames = listMapFiles(mapArchiveIndex, oldMapArchiveIndex);
 	const std::vector<const char *> lookin_list = { "WZMap", "WZMap/multiplay" };
+	bool mapArchiveIndexChanged = mapArchiveIndex.size() != oldMapArchiveIndex.size();
+	for (auto const &entry : mapArchiveIndex)
+	{
+		auto old = oldMapArchiveIndex.find(entry.first);
+		mapArchiveIndexChanged = mapArchiveIndexChanged || old == oldMapArchiveIndex.end() || old->second.size != entry.second.size || old->second.modtime != entry.second.modtime || old->second.realDir != entry.second.realDir;
+	}
 	for (auto &realFileName : realFileNames)
 	{
 		struct WZmapInfo CurrentMap;
+		auto info = mapArchiveIndex.find(realFileName.platformIndependent);
+		if (info != mapArchiveIndex.end() && info->second.scanned)
+		{
+			for (auto const &levFile : info->second.levFiles)
+			{
+				debug(LOG_WZ, "Loading lev file: \"%s\" from \"%s\" (indexed)\n", levFile.first.c_str(), realFileName.platformIndependent.c_str());
+				if (!levParse(levFile.second.data(), levFile.second.size(), mod_multiplay, true, realFileName.platformIndependent.c_str()))
+				{
+					debug(LOG_ERROR, "Parse error in %s\n", levFile.first.c_str());
+				}
+			}
+			CurrentMap.isMapMod = info->second.isMapMod;
+			CurrentMap.isRandom = info->second.isRandom;
+			WZ_Maps.insert(WZMapInfo_Map::value_type(realFileName.platformIndependent, std::move(CurrentMap)));
+			continue;
+		}
+
 		const char * pRealDirStr = PHYSFS_getRealDir(realFileName.platformIndependent.c_str());
 		if (!pRealDirStr)
 		{
@@ -688,14 +841,17 @@ bool buildMapList()
 
 		WZ_PHYSFS_enumerateFiles("", [&](const char *file) -> bool {
 			size_t len = strlen(file);
-			if (len > 10 && !strcasecmp(file + (len - 10), ".addon.lev"))  // Do not add addon.lev again
-			{
-				loadLevFile(file, mod_multiplay, true, realFileName.platformIndependent.c_str());
-			}
-			// add support for X player maps using a new name to prevent conflicts.
-			if (len > 13 && !strcasecmp(file + (len - 13), ".xplayers.lev"))
+			// Do not add addon.lev again, and add support for X player maps using a new name to prevent conflicts.
+			if ((len > 10 && !strcasecmp(file + (len - 10), ".addon.lev")) || (len > 13 && !strcasecmp(file + (len - 13), ".xplayers.lev")))
 			{
 				loadLevFile(file, mod_multiplay, true, realFileName.platformIndependent.c_str());
+				char *pBuffer = nullptr;
+				UDWORD size = 0;
+				if (info != mapArchiveIndex.end() && loadFile(file, &pBuffer, &size))
+				{
+					info->second.levFiles.emplace_back(file, std::string(pBuffer, size));
+					free(pBuffer);
+				}
 			}
 			return true; // continue
 		});
@@ -711,6 +867,17 @@ bool buildMapList()
 		CurrentMap.isMapMod = chk.first;
 		CurrentMap.isRandom = chk.second;
 		WZ_Maps.insert(WZMapInfo_Map::value_type(MapName, std::move(CurrentMap)));
+		if (info != mapArchiveIndex.end())
+		{
+			info->second.isMapMod = chk.first;
+			info->second.isRandom = chk.second;
+			info->second.scanned = true;
+		}
+	}
+
+	if (mapArchiveIndexChanged)
+	{
+		saveMapArchiveIndex(mapArchiveIndex);
 	}
 
 	return true;
@@ -776,6 +943,7 @@ bool systemInitialise(float horizScaleFactor, float vertScaleFactor)
 //
 void systemShutdown()
 {
+	waitForBackgroundSave();
 	pie_ShutdownRadar();
 	clearLoadedMods();
 	flushConsoleMessages();
@@ -1147,7 +1315,7 @@ bool stageTwoInitialise()
 	{
 		NETinitQueue(NETgameQueue(i));
 
-		if (!myResponsibility(i))
+		if (!myResponsibility(i) || NETisReplay())
 		{
 			NETsetNoSendOverNetwork(NETgameQueue(i));
 		}
@@ -22,6 +22,7 @@
 #include "lib/framework/frame.h"
 #include "lib/framework/wzapp.h"
 #include "lib/framework/rational.h"
+#include "lib/framework/file.h"
 #include "objects.h"
 #include "levels.h"
 #include "basedef.h"
@@ -36,6 +37,7 @@
 #include "mechanics.h"
 #include "lib/sound/audio.h"
 #include "lib/sound/audio_id.h"
+#include "lib/sound/tracklib.h"
 #include "lighting.h"
 #include "power.h"
 #include "hci.h"
@@ -50,7 +52,9 @@
 
 #include "cheat.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netsocket.h"
 #include "multiplay.h"
+#include "statehash.h"
 #include "multimenu.h"
 #include "atmos.h"
 #include "advvis.h"
@@ -645,7 +649,35 @@ void	kf_FrameRate()
 		                          NETgetStatistic(NetStatisticUncompressedBytes, false),
 		                          NETgetStatistic(NetStatisticPackets, true),
 		                          NETgetStatistic(NetStatisticPackets, false));
-	}
+		SocketCompressionStats compression;
+		if (NETgetCompressionStats(compression))
+		{
+			CONPRINTF("NETWORK:  Compression: level %d  ratio %.2f  deflate time %.1f ms",
+			                          compression.level,
+			                          compression.compressedBytes != 0 ? (double)compression.uncompressedBytes / compression.compressedBytes : 0.0,
+			                          compression.deflateMicroseconds / 1000.0);
+			for (unsigned i = 0; i < MAX_CONNECTED_PLAYERS; ++i)
+			{
+				if (NETgetConnectionCompressionStats(i, compression))
+				{
+					CONPRINTF("NETWORK:    Connection %u: level %d  ratio %.2f  deflate time %.1f ms", i,
+					                          compression.level,
+					                          compression.compressedBytes != 0 ? (double)compression.uncompressedBytes / compression.compressedBytes : 0.0,
+					                          compression.deflateMicroseconds / 1000.0);
+				}
+			}
+		}
+		CONPRINTF("SYNC:  State hash time %u us%s", stateHashMicroseconds(), stateHashDesynchedSubsystems() != 0 ? "  (desynched)" : "");
+		CONPRINTF("SYNC:  Input delay %u ms  Network wants %u ms  Tick waits %s", (unsigned)gameTimeInputDelay(), (unsigned)networkInputDelay(), gameTimeWaitHistogramString().c_str());
+	}
+	AssetCacheStats assetCache = assetCacheStats();
+	CONPRINTF("ASSETS:  Cache hits %zu misses %zu  %zu files in %zu KiB", assetCache.hits, assetCache.misses, assetCache.entries, assetCache.bytes / 1024);
+	AudioDecodeStats audioDecode = sound_GetDecodeStats();
+	CONPRINTF("AUDIO:  Decode time %.1f ms  Decoded track cache hits %zu misses %zu (%zu KiB)  Stream underruns %zu", audioDecode.decodeMicroseconds / 1000.0,
+	                          audioDecode.trackCacheHits, audioDecode.trackCacheMisses, audioDecode.trackCacheBytes / 1024, audioDecode.streamUnderruns);
+	AudioVoiceStats audioVoices = sound_GetVoiceStats();
+	CONPRINTF("VOICES:  %zu/%zu playing  %zu virtual  Started %zu  virtualised %zu  stolen %zu  revived %zu", audioVoices.voices, audioVoices.budget, audioVoices.virtualVoices,
+	                          audioVoices.started, audioVoices.virtualised, audioVoices.stolen, audioVoices.revived);
 	gameStats = !gameStats;
 	CONPRINTF("Built: %s %s", getCompileDate(), __TIME__);
 }
@@ -34,6 +34,7 @@
 #include "lib/framework/physfs_ext.h"
 #include "lib/gamelib/gtime.h"
 #include "lib/exceptionhandler/dumpinfo.h"
+#include "lib/netplay/netreplay.h"
 #include "clparse.h"
 #include "init.h"
 #include "objects.h"
@@ -1049,6 +1050,11 @@ bool levLoadData(char const *name, Sha256 const *hash, char *pSaveName, GAME_TYP
 	ssprintf(buf, "Current Level/map is %s", psCurrLevel->pName);
 	addDumpInfo(buf);
 
+	if (NETisReplay() && headlessGameMode())
+	{
+		gameTimeSetMod(Rational(500));  // Re-simulate as fast as we can.
+	}
+
 	if (autogame_enabled())
 	{
 		gameTimeSetMod(Rational(500));
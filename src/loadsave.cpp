@@ -449,6 +449,9 @@ void deleteSaveGame(char *fileName)
 {
 	ASSERT(strlen(fileName) < MAX_STR_LENGTH, "deleteSaveGame; save game name too long");
 
+	waitForScriptStateSave();
+	waitForBackgroundSave();
+
 	PHYSFS_delete(fileName);
 	fileName[strlen(fileName) - 4] = '\0'; // strip extension
 
@@ -948,6 +951,11 @@ bool autoSave()
 	{
 		return false;
 	}
+	if (isBackgroundSaveInProgress())
+	{
+		debug(LOG_SAVE, "Skipping autosave, the previous one is still being written");
+		return false;
+	}
 	const char *dir = bMultiPlayer? AUTOSAVE_SKI_DIR : AUTOSAVE_CAM_DIR;
 	freeAutoSaveSlot(dir);
 
@@ -959,9 +967,19 @@ bool autoSave()
 	std::string withoutTechlevel = mapNameWithoutTechlevel(getLevelName());
 	char savefile[PATH_MAX];
 	snprintf(savefile, sizeof(savefile), "%s/%s_%s.gam", dir, withoutTechlevel.c_str(), savedate);
-	if (saveGame(savefile, GTYPE_SAVE_MIDMISSION))
+	// Only reported once the files have been written
+	std::string saveName = savefile;
+	if (saveGame(savefile, GTYPE_SAVE_MIDMISSION, true, [saveName](bool ok) {
+		if (ok)
+		{
+			console("AutoSave %s", saveName.c_str());
+		}
+		else
+		{
+			console("AutoSave %s failed", saveName.c_str());
+		}
+	}))
 	{
-		console("AutoSave %s", savefile);
 		return true;
 	}
 	else
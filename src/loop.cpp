@@ -39,6 +39,7 @@
 #include "lib/sound/cdaudio.h"
 #include "lib/sound/mixer.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
 
 #include "loop.h"
 #include "objects.h"
@@ -58,6 +59,7 @@
 #include "warzoneconfig.h"
 
 #include "multiplay.h" //ajl
+#include "statehash.h"
 #include "levels.h"
 #include "visibility.h"
 #include "multimenu.h"
@@ -526,6 +528,7 @@ static void gameStateUpdate()
 	sendQueuedDroidInfo();
 
 	sendPlayerGameTime();
+	sendStateHashes();
 	NETflush();  // Make sure the game time tick message is really sent over the network.
 
 	if (!paused && !scriptPaused())
@@ -674,6 +677,12 @@ GAMECODE gameLoop()
 		stdOutGameSummary();
 	}
 
+	if (headlessGameMode() && NETreplayLoadFinished())
+	{
+		stdOutGameSummary(0);
+		exit(0);
+	}
+
 	return renderReturn;
 }
 
@@ -40,6 +40,7 @@
 #  include <errno.h>
 #endif // WZ_OS_WIN
 
+#include "lib/framework/file.h"
 #include "lib/framework/input.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzpaths.h"
@@ -145,6 +146,10 @@ static FOCUS_STATE focusState = FOCUS_IN;
 static bool ignoredSIGPIPE = false;
 #endif
 
+// The script bytecode cache is keyed by the sources, so entries of old game versions, mods and edits are never looked up again
+#define CACHE_DIR_MAX_BYTES		(64 * 1024 * 1024)
+#define CACHE_DIR_MAX_AGE_DAYS	30
+
 
 #if defined(WZ_OS_WIN)
 
@@ -1361,6 +1366,9 @@ int realmain(int argc, char *argv[])
 
 	PHYSFS_mkdir("autohost");	// autohost games launched with --autohost=game
 
+	PHYSFS_mkdir("cache/scripts");	// compiled script bytecode
+	pruneCacheDirectory("cache/scripts", CACHE_DIR_MAX_BYTES, CACHE_DIR_MAX_AGE_DAYS);
+
 	PHYSFS_mkdir("challenges");	// custom challenges
 
 	PHYSFS_mkdir("logs");		// netplay, mingw crash reports & WZ logs
@@ -1384,6 +1392,8 @@ int realmain(int argc, char *argv[])
 	PHYSFS_mkdir("savegames/skirmish");		// skirmish save games
 	PHYSFS_mkdir("savegames/skirmish/auto");	// skirmish autosave games
 
+	PHYSFS_mkdir("replay/multiplay");	// replays of skirmish and multiplayer games
+
 	make_dir(ScreenDumpPath, "screenshots", nullptr);	// for screenshots
 
 	PHYSFS_mkdir("tests");			// test games launched with --skirmish=game
@@ -524,15 +524,30 @@ void sendQueuedDroidInfo()
 		NETuint32_t(&num);
 
 		uint32_t prevDroidId = 0;
-		for (unsigned n = 0; n < num; ++n)
+		for (unsigned n = 0; n < num;)
 		{
 			uint32_t droidId = (eqBegin + n)->droidId;
 
 			// Encode deltas between droid IDs, since the deltas are smaller than the actual droid IDs, and will encode to less bytes on average.
 			uint32_t deltaDroidId = droidId - prevDroidId;
-			NETuint32_t(&deltaDroidId);
+			ASSERT(deltaDroidId < 0x80000000, "Droid IDs not sorted?");
 
-			prevDroidId = droidId;
+			// Droids built in a row tend to have evenly spaced IDs, so count the following droids whose IDs continue with the same delta.
+			// If there are any, the lowest bit of the delta says that the count follows, and those droids are not sent individually.
+			uint32_t runLength = 0;
+			while (n + 1 + runLength < num && (eqBegin + n + 1 + runLength)->droidId - (eqBegin + n + runLength)->droidId == deltaDroidId)
+			{
+				++runLength;
+			}
+			uint32_t deltaAndRunFlag = deltaDroidId << 1 | (runLength != 0 ? 1 : 0);
+			NETuint32_t(&deltaAndRunFlag);
+			if (runLength != 0)
+			{
+				NETuint32_t(&runLength);
+			}
+
+			prevDroidId = droidId + runLength * deltaDroidId;
+			n += 1 + runLength;
 		}
 		NETend();
 	}
@@ -646,11 +661,25 @@ bool recvDroidInfo(NETQUEUE queue)
 		uint32_t num = 0;
 		NETuint32_t(&num);
 
+		uint32_t deltaDroidId = 0;
+		uint32_t runLength = 0;  // Number of following droids whose IDs continue with the same delta (see sendQueuedDroidInfo).
 		for (unsigned n = 0; n < num; ++n)
 		{
 			// Get the next droid ID which is being given this order.
-			uint32_t deltaDroidId = 0;
-			NETuint32_t(&deltaDroidId);
+			if (runLength != 0)
+			{
+				--runLength;
+			}
+			else
+			{
+				uint32_t deltaAndRunFlag = 0;
+				NETuint32_t(&deltaAndRunFlag);
+				deltaDroidId = deltaAndRunFlag >> 1;
+				if ((deltaAndRunFlag & 1) != 0)
+				{
+					NETuint32_t(&runLength);
+				}
+			}
 			info.droidId += deltaDroidId;
 
 			DROID *psDroid = IdToDroid(info.droidId, info.player);
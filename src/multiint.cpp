@@ -51,6 +51,7 @@
 
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
 #include "lib/widget/editbox.h"
 #include "lib/widget/button.h"
 #include "lib/widget/scrollablelist.h"
@@ -277,6 +278,7 @@ struct AIDATA
 	int assigned;                   ///< How many AIs have we assigned of this type
 };
 static std::vector<AIDATA> aidata;
+static nlohmann::json replaySettings;  ///< Settings of the replay being played back, if any.
 
 struct WzMultiButton : public W_BUTTON
 {
@@ -464,7 +466,7 @@ void loadMultiScripts()
 				continue;
 			}
 
-			if (NetPlay.players[i].ai >= 0 && myResponsibility(i))
+			if (NetPlay.players[i].ai >= 0 && myResponsibility(i) && !NETisReplay())
 			{
 				if (aidata[NetPlay.players[i].ai].js[0] != '\0')
 				{
@@ -475,8 +477,8 @@ void loadMultiScripts()
 		}
 	}
 
-	// Load scavengers
-	if (game.scavengers && myResponsibility(scavengerPlayer()))
+	// Load scavengers. (Replays already have everything AIs and scavengers did.)
+	if (game.scavengers && myResponsibility(scavengerPlayer()) && !NETisReplay())
 	{
 		debug(LOG_SAVE, "Loading scavenger AI for player %d", scavengerPlayer());
 		loadPlayerScript("multiplay/script/scavengers/init.js", scavengerPlayer(), AIDifficulty::EASY);
@@ -2727,7 +2729,7 @@ void WzMultiplayerOptionsTitleUI::addPlayerBox(bool players)
  */
 static void SendFireUp()
 {
-	uint32_t randomSeed = rand();  // Pick a random random seed for the synchronised random number generator.
+	uint32_t randomSeed = NETisReplay() ? replaySettings.value("seed", 0u) : rand();  // Pick a random random seed for the synchronised random number generator.
 
 	NETbeginEncode(NETbroadcastQueue(), NET_FIREUP);
 	NETuint32_t(&randomSeed);
@@ -3364,11 +3366,151 @@ static void resetPlayerConfiguration(const bool bShouldResetLocal = false)
 	}
 }
 
+/**
+ * Describes the game that is starting, so that a replay can set it up again with loadReplaySettings().
+ */
+std::string replayGameSettings()
+{
+	nlohmann::json settings = nlohmann::json::object();
+	settings["map"] = game.map;
+	settings["mapHash"] = game.hash.toString();
+	settings["maxPlayers"] = game.maxPlayers;
+	settings["scavengers"] = game.scavengers;
+	settings["alliances"] = game.alliance;
+	settings["powerLevel"] = game.power;
+	settings["bases"] = game.base;
+	settings["techLevel"] = game.techLevel;
+	settings["flags"] = ingame.flags;
+	settings["seed"] = gameRandSeed();
+
+	nlohmann::json limits = nlohmann::json::array();
+	for (auto const &limit : ingame.structureLimits)
+	{
+		limits.push_back({limit.id, limit.limit});
+	}
+	settings["structureLimits"] = limits;
+
+	nlohmann::json players = nlohmann::json::array();
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		PLAYER const &player = NetPlay.players[i];
+		nlohmann::json playerSettings = nlohmann::json::object();
+		playerSettings["name"] = player.name;
+		playerSettings["position"] = player.position;
+		playerSettings["colour"] = player.colour;
+		playerSettings["team"] = player.team;
+		playerSettings["allocated"] = player.allocated;
+		playerSettings["ai"] = player.ai;
+		if (player.ai >= 0 && player.ai < (int)aidata.size())
+		{
+			playerSettings["aiScript"] = aidata[player.ai].js;  // AI indices depend on which AIs are installed.
+		}
+		playerSettings["difficulty"] = static_cast<int>(player.difficulty);
+		playerSettings["faction"] = static_cast<int>(player.faction);
+		players.push_back(playerSettings);
+	}
+	settings["players"] = players;
+
+	return settings.dump();
+}
+
+/**
+ * Loads a replay given with --replay, and sets up the game it was recorded from.
+ */
+static bool loadReplaySettings(std::string const &filename)
+{
+	std::string settingsString;
+	if (!NETreplayLoadStart(filename, settingsString))
+	{
+		return false;
+	}
+	replaySettings = nlohmann::json::parse(settingsString, nullptr, false);
+	if (replaySettings.is_discarded() || !replaySettings.is_object() || !replaySettings["players"].is_array())
+	{
+		debug(LOG_ERROR, "Replay %s has invalid settings", filename.c_str());
+		replaySettings = nlohmann::json();
+		NETreplayLoadStop();
+		return false;
+	}
+
+	sstrcpy(game.map, replaySettings.value("map", "").c_str());
+	game.hash = levGetMapNameHash(game.map);
+	if (game.hash.toString() != replaySettings.value("mapHash", ""))
+	{
+		debug(LOG_WARNING, "Map %s differs from the one the replay was recorded on", game.map);
+	}
+	if (levFindDataSet(game.map, &game.hash) == nullptr)
+	{
+		debug(LOG_ERROR, "Map %s not found!", game.map);
+		replaySettings = nlohmann::json();
+		NETreplayLoadStop();
+		return false;
+	}
+	game.maxPlayers = replaySettings.value("maxPlayers", game.maxPlayers);
+	game.scavengers = replaySettings.value("scavengers", game.scavengers);
+	game.alliance = replaySettings.value("alliances", game.alliance);
+	game.power = replaySettings.value("powerLevel", game.power);
+	game.base = replaySettings.value("bases", game.base);
+	game.techLevel = replaySettings.value("techLevel", game.techLevel);
+	ingame.flags = replaySettings.value("flags", ingame.flags);
+
+	nlohmann::json const &players = replaySettings["players"];
+	for (unsigned i = 0; i < MAX_PLAYERS && i < players.size(); ++i)
+	{
+		nlohmann::json const &playerSettings = players[i];
+		PLAYER &player = NetPlay.players[i];
+		sstrcpy(player.name, playerSettings.value("name", "").c_str());
+		player.position = playerSettings.value("position", player.position);
+		setPlayerColour(i, playerSettings.value("colour", player.colour));
+		player.team = playerSettings.value("team", player.team);
+		player.ai = playerSettings.value("ai", player.ai);
+		if (playerSettings.contains("aiScript"))
+		{
+			WzString aiScript = WzString::fromUtf8(playerSettings["aiScript"].get<std::string>());
+			resolveAIForPlayer(i, aiScript);
+		}
+		player.difficulty = static_cast<AIDifficulty>(playerSettings.value("difficulty", static_cast<int>(player.difficulty)));
+		player.faction = static_cast<FactionID>(playerSettings.value("faction", static_cast<int>(player.faction)));
+	}
+	return true;
+}
+
+/**
+ * Replays need some settings that the host only makes as the game starts.
+ */
+static void applyReplayStartSettings()
+{
+	ingame.structureLimits.clear();
+	for (auto const &limit : replaySettings["structureLimits"])
+	{
+		MULTISTRUCTLIMITS structLimit;
+		structLimit.id = limit.at(0).get<uint32_t>();
+		structLimit.limit = limit.at(1).get<uint32_t>();
+		ingame.structureLimits.push_back(structLimit);
+	}
+
+	// Only the game queues of human players are read (see checkPlayerGameTime), so these must match the recording.
+	nlohmann::json const &players = replaySettings["players"];
+	for (unsigned i = 0; i < MAX_PLAYERS && i < players.size(); ++i)
+	{
+		NetPlay.players[i].allocated = players[i].value("allocated", false);
+	}
+}
+
 /**
  * Loads challenge and player configurations from level/autohost/test .json-files.
  */
 static void loadMapChallengeAndPlayerSettings(bool forceLoadPlayers = false)
 {
+	if (!wz_replay().empty())
+	{
+		if (!NETisReplay() && !loadReplaySettings(wz_replay()))
+		{
+			exit(1);
+		}
+		return;
+	}
+
 	char aFileName[256];
 	LEVEL_DATASET* psLevel = levFindDataSet(game.map, &game.hash);
 
@@ -4008,6 +4150,10 @@ void startMultiplayerGame()
 
 		resetDataHash();	// need to reset it, since host's data has changed.
 		createLimitSet();
+		if (NETisReplay())
+		{
+			applyReplayStartSettings();
+		}
 		debug(LOG_NET, "sending our options to all clients");
 		sendOptions();
 		NEThaltJoining();							// stop new players entering.
@@ -4681,7 +4827,7 @@ void WzMultiplayerOptionsTitleUI::start()
 		updateLimitIcons();
 	}
 
-	if (autogame_enabled() || getHostLaunch() == HostLaunch::Autohost)
+	if (autogame_enabled() || getHostLaunch() == HostLaunch::Autohost || NETisReplay())
 	{
 		if (!ingame.localJoiningInProgress)
 		{
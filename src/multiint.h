@@ -78,6 +78,7 @@ void loadMapPreview(bool hideInterface);
 bool changeReadyStatus(UBYTE player, bool bReady);
 WzString formatGameName(WzString name);
 void resetVoteData();
+std::string replayGameSettings();  ///< Settings for a replay of the game that is starting.
 void sendRoomSystemMessage(char const *text);
 void displayRoomSystemMessage(char const *text);
 void displayRoomNotifyMessage(char const *text);
@@ -485,6 +485,7 @@ bool recvDataCheck(NETQUEUE queue)
 void setupNewPlayer(UDWORD player)
 {
 	ingame.PingTimes[player] = 0;					// Reset ping time
+	resetPingJitter(player);
 	ingame.JoiningInProgress[player] = true;			// Note that player is now joining
 	ingame.DataIntegrity[player] = false;
 
@@ -42,6 +42,8 @@
 #include "lib/widget/widget.h"
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
+#include "lib/framework/wztime.h"
 #include "hci.h"
 #include "configuration.h"			// lobby cfg.
 #include "clparse.h"
@@ -63,6 +65,8 @@
 #include "multirecv.h"
 #include "template.h"
 #include "activity.h"
+#include "warzoneconfig.h"
+#include "statehash.h"
 
 // send complete game info set!
 void sendOptions()
@@ -446,6 +450,19 @@ bool multiGameInit()
 	}
 
 	gameInit();
+	stateHashReset();
+
+	// Replays start from the game settings, so can't be recorded from a savegame.
+	const bool fromSave = getLevelLoadType() == GTYPE_SAVE_START || getLevelLoadType() == GTYPE_SAVE_MIDMISSION;
+	if (war_getRecordReplays() && !NETisReplay() && !fromSave)
+	{
+		time_t aclock;
+		time(&aclock);
+		auto newtime = getLocalTime(aclock);
+		char filename[256];
+		ssprintf(filename, "replay/multiplay/%04d%02d%02d_%02d%02d%02d_%s_p%u.wzrp", newtime.tm_year + 1900, newtime.tm_mon + 1, newtime.tm_mday, newtime.tm_hour, newtime.tm_min, newtime.tm_sec, mapNameWithoutTechlevel(game.map).c_str(), selectedPlayer);
+		NETreplaySaveStart(filename, replayGameSettings());
+	}
 
 	return true;
 }
@@ -458,6 +475,10 @@ bool multiGameShutdown()
 	uint32_t        time;
 
 	debug(LOG_NET, "%s is shutting down.", getPlayerName(selectedPlayer));
+	debug(LOG_INFO, "Ticks by time spent waiting for other players: %s", gameTimeWaitHistogramString().c_str());
+
+	NETreplaySaveStop();
+	NETreplayLoadStop();
 
 	sendLeavingMsg();							// say goodbye
 
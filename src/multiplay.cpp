@@ -65,6 +65,7 @@
 #include "lib/netplay/netplay.h"								// the netplay library.
 #include "modding.h"
 #include "multiplay.h"								// warzone net stuff.
+#include "statehash.h"
 #include "multijoin.h"								// player management stuff.
 #include "multirecv.h"								// incoming messages stuff
 #include "multistat.h"
@@ -688,6 +689,9 @@ bool recvMessage()
 			case GAME_SYNC_REQUEST:
 				recvSyncRequest(queue);
 				break;
+			case GAME_STATE_HASH:
+				recvStateHashes(queue);
+				break;
 			case GAME_DROIDDISEMBARK:
 				recvDroidDisEmbark(queue);           //droid has disembarked from a Transporter
 				break;
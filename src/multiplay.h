@@ -261,6 +261,8 @@ bool multiGameShutdown();
 // syncing.
 bool sendScoreCheck();							//score check only(frontend)
 bool sendPing();							// allow game to request pings.
+UDWORD networkInputDelay();					// worst one-way ping to another human player, plus a margin for its jitter, in milliseconds.
+void resetPingJitter(UDWORD player);				// forget the jitter measured for a player, along with their ping time.
 void HandleBadParam(const char *msg, const int from, const int actual);
 // multijoin
 bool sendResearchStatus(const STRUCTURE *psBuilding, UDWORD index, UBYTE player, bool bStart);
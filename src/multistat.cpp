@@ -237,6 +237,7 @@ void recvMultiStats(NETQUEUE queue)
 		if (identity != prevIdentity)
 		{
 			ingame.PingTimes[playerIndex] = PING_LIMIT;
+			resetPingJitter(playerIndex);
 		}
 	}
 	NETend();
@@ -49,6 +49,7 @@ static UDWORD averagePing();
 
 static UDWORD				PingSend[MAX_PLAYERS];	//stores the time the ping was called.
 static uint8_t pingChallenge[8];                                // Random data sent with the last ping.
+static int pingJitter[MAX_PLAYERS];                             // Smoothed change between successive pings, as in RFC 3550.
 
 
 // ////////////////////////////////////////////////////////////////////////
@@ -96,6 +97,25 @@ static UDWORD averagePing()
 	return total / MAX(count, 1);
 }
 
+void resetPingJitter(UDWORD player)
+{
+	ASSERT_OR_RETURN(, player < MAX_PLAYERS, "Invalid player %u", player);
+	pingJitter[player] = 0;
+}
+
+UDWORD networkInputDelay()
+{
+	UDWORD delay = 0;
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		if (isHumanPlayer(i) && i != selectedPlayer && ingame.PingTimes[i] < PING_LIMIT)
+		{
+			delay = std::max<UDWORD>(delay, ingame.PingTimes[i] + 2 * pingJitter[i]);
+		}
+	}
+	return delay;
+}
+
 bool sendPing()
 {
 	bool			isNew = true;
@@ -145,6 +165,7 @@ bool sendPing()
 		    && i != selectedPlayer)
 		{
 			ingame.PingTimes[i] = PING_LIMIT;
+			resetPingJitter(i);
 		}
 		else if (!isHumanPlayer(i)
 		         && PingSend[i]
@@ -152,6 +173,7 @@ bool sendPing()
 		         && i != selectedPlayer)
 		{
 			ingame.PingTimes[i] = 0;
+			resetPingJitter(i);
 		}
 	}
 
@@ -225,7 +247,13 @@ bool recvPing(NETQUEUE queue)
 		}
 
 		// Work out how long it took them to respond
-		ingame.PingTimes[sender] = (realTime - PingSend[sender]) / 2;
+		UDWORD newPing = (realTime - PingSend[sender]) / 2;
+		if (ingame.PingTimes[sender] != 0 && ingame.PingTimes[sender] < PING_LIMIT)
+		{
+			int change = abs((int)newPing - (int)ingame.PingTimes[sender]);
+			pingJitter[sender] += (change - pingJitter[sender]) / 4;  // Pings are only every few seconds, so adapt faster than RFC 3550's 1/16.
+		}
+		ingame.PingTimes[sender] = newPing;
 
 		// Note that we have received it
 		PingSend[sender] = 0;
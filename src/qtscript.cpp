@@ -42,6 +42,7 @@
 #include "lib/framework/wzapp.h"
 #include "lib/framework/wzconfig.h"
 #include "lib/framework/wzpaths.h"
+#include "lib/framework/wzthreadpool.h"
 
 #include "qtscript.h"
 
@@ -67,6 +68,7 @@
 #include <sstream>
 #include <iomanip>
 #include <queue>
+#include <limits>
 
 #include "wzscriptdebug.h"
 #include "quickjs_backend.h"
@@ -392,6 +394,8 @@ bool shutdownScripts()
 bool scripting_engine::shutdownScripts()
 {
 	scriptsReady = false;
+	delete scriptStateWriter;  // waits for a pending script state file
+	scriptStateWriter = nullptr;
 	jsDebugShutdown();
 	globalDialog = false;
 	for (auto *instance : scripts)
@@ -421,6 +425,7 @@ bool scripting_engine::shutdownScripts()
 	timers.clear();
 	lastTimerID = 0;
 	timerIDMap.clear();
+	eventBatches.clear();
 	monitors.clear();
 	for (auto& script : scripts)
 	{
@@ -452,6 +457,7 @@ bool scripting_engine::updateScripts()
 	{
 		instance->updateGameTime(gameTime);
 	}
+	flushEventBatches();
 	// Weed out dead timers
 	removeTimersIf([](const timerNode& node)
 	{
@@ -709,26 +715,49 @@ bool saveScriptStates(const char *filename)
 	return scripting_engine::instance().saveScriptStates(filename);
 }
 
+static bool writeScriptStateFile(const std::string &filename, const nlohmann::json &root)
+{
+	// same output as WzConfig, streamed straight to the file
+	return saveJsonFile(filename.c_str(), root, JSON_FILE_TEXT);
+}
+
+void waitForScriptStateSave()
+{
+	scripting_engine::instance().waitForScriptStateSave();
+}
+
+void scripting_engine::waitForScriptStateSave()
+{
+	if (scriptStateWriter)
+	{
+		scriptStateWriter->waitForAll();
+	}
+}
+
 bool scripting_engine::saveScriptStates(const char *filename)
 {
-	WzConfig ini(filename, WzConfig::ReadAndWrite);
+	// a previous save may still be writing to the same file
+	waitForScriptStateSave();
+
+	std::shared_ptr<nlohmann::json> ini = std::make_shared<nlohmann::json>(nlohmann::json::object());
 	for (int i = 0; i < scripts.size(); ++i)
 	{
 		wzapi::scripting_instance* instance = scripts.at(i);
 
-		nlohmann::json globalsResult = nlohmann::json::object();
-		instance->saveScriptGlobals(globalsResult);
+		// Scripts that have not run since the last save (such as AIs of defeated players, or anything while paused)
+		// still have the same globals, so their last snapshot is reused instead of walking the script context again.
+		const nlohmann::json &globalsResult = instance->snapshotScriptGlobals();
 		// 'scriptName' and 'me' should be saved implicitly by the backend's saveScriptGlobals
 		ASSERT(globalsResult.contains("me"), "Missing required global \"me\"");
 		ASSERT(globalsResult.contains("scriptName"), "Missing required global \"scriptName\"");
-		ini.setValue("globals_" + WzString::number(i), globalsResult);
+		(*ini)["globals_" + std::to_string(i)] = globalsResult;
 
 		// we have to save 'scriptName' and 'me' explicitly
 		nlohmann::json groupsResult = nlohmann::json::object();
 		saveGroups(groupsResult, instance);
 		groupsResult["me"] = instance->player();
 		groupsResult["scriptName"] = instance->scriptName();
-		ini.setValue("groups_" + WzString::number(i), groupsResult);
+		(*ini)["groups_" + std::to_string(i)] = std::move(groupsResult);
 	}
 	size_t timerIdx = 0;
 	for (const auto& node : timers)
@@ -750,10 +779,27 @@ bool scripting_engine::saveScriptStates(const char *filename)
 		nodeInfo["calls"] = node->calls;
 		nodeInfo["type"] = (int)node->type;
 
-		ini.setValue("triggers_" + WzString::number(timerIdx), nodeInfo);
+		(*ini)["triggers_" + std::to_string(timerIdx)] = std::move(nodeInfo);
 		++timerIdx;
 	}
-	return true;
+
+	// The snapshot above is all that needs the script contexts - encoding and writing it out can happen off the main thread
+	std::string file = filename;
+	if (war_getBackgroundScriptStateSave())
+	{
+		if (!scriptStateWriter)
+		{
+			scriptStateWriter = new WzThreadPool(1);
+		}
+		scriptStateWriter->addJob([file, ini]() {
+			if (!writeScriptStateFile(file, *ini))
+			{
+				debug(LOG_ERROR, "Failed to write the script state to %s", file.c_str());
+			}
+		});
+		return true;
+	}
+	return writeScriptStateFile(file, *ini);
 }
 
 wzapi::scripting_instance* scripting_engine::findInstanceForPlayer(int match, const WzString& _scriptName)
@@ -781,6 +827,7 @@ bool loadScriptStates(const char *filename)
 bool scripting_engine::loadScriptStates(const char *filename)
 {
 	uniqueTimerID maxRestoredTimerID = 0;
+	waitForScriptStateSave();
 	WzConfig ini(filename, WzConfig::ReadOnly);
 	std::vector<WzString> list = ini.childGroups();
 	debug(LOG_SAVE, "Loading script states for %zu script contexts", scripts.size());
@@ -1322,7 +1369,10 @@ bool triggerEventAttacked(BASE_OBJECT *psVictim, BASE_OBJECT *psAttacker, int la
 		bool receiveAll = instance->isReceivingAllEvents();
 		if (player == psVictim->player || receiveAll)
 		{
-			instance->handle_eventAttacked(psVictim, psAttacker);
+			if (!scripting_engine::instance().batchEvent(instance, scripting_engine::BatchedEvent::Attacked, psVictim, psAttacker))
+			{
+				instance->handle_eventAttacked(psVictim, psAttacker);
+			}
 		}
 	}
 	return true;
@@ -1414,7 +1464,7 @@ bool scripting_engine::triggerEventSeen(BASE_OBJECT *psViewer, BASE_OBJECT *psSe
 	for (auto *instance : scripts)
 	{
 		std::pair<bool, int> callbacks = scripting_engine::instance().seenLabelCheck(instance, psSeen, psViewer);
-		if (callbacks.first)
+		if (callbacks.first && !batchEvent(instance, BatchedEvent::ObjectSeen, psViewer, psSeen))
 		{
 			instance->handle_eventObjectSeen(psViewer, psSeen);
 		}
@@ -1427,6 +1477,83 @@ bool scripting_engine::triggerEventSeen(BASE_OBJECT *psViewer, BASE_OBJECT *psSe
 	return true;
 }
 
+bool scripting_engine::batchEvent(wzapi::scripting_instance *instance, BatchedEvent event, const BASE_OBJECT *psFirst, const BASE_OBJECT *psSecond)
+{
+	auto it = eventBatches.find(instance);
+	if (it == eventBatches.end())
+	{
+		return false;
+	}
+	EventBatch &batch = it->second[static_cast<size_t>(event)];
+	if (!batch.enabled)
+	{
+		return false;
+	}
+	if (batch.dedup != EVENT_BATCH_DEDUP_NONE)
+	{
+		const BASE_OBJECT *psKey = (batch.dedup == EVENT_BATCH_DEDUP_FIRST) ? psFirst : psSecond;
+		auto inserted = batch.dedupIndex.insert(std::make_pair(psKey->id, batch.entries.size()));
+		if (!inserted.second)
+		{
+			batch.entries[inserted.first->second].count++;
+			return true;
+		}
+	}
+	batch.entries.push_back(EventBatch::Entry{wzapi::game_object_identifier(psFirst), wzapi::game_object_identifier(psSecond), 1});
+	return true;
+}
+
+void scripting_engine::flushEventBatches()
+{
+	std::vector<wzapi::batched_event> events;
+	for (auto *instance : scripts)
+	{
+		auto it = eventBatches.find(instance);
+		if (it == eventBatches.end())
+		{
+			continue;
+		}
+		for (size_t i = 0; i < it->second.size(); ++i)
+		{
+			EventBatch &batch = it->second[i];
+			if (batch.entries.empty())
+			{
+				continue;
+			}
+			// Objects may have died since the event, so look them up again
+			events.clear();
+			for (const auto &entry : batch.entries)
+			{
+				wzapi::batched_event event;
+				event.psFirst = IdToObject((OBJECT_TYPE)entry.first.type, entry.first.id, entry.first.player);
+				if (!event.psFirst || event.psFirst->died)
+				{
+					continue;
+				}
+				event.psSecond = IdToObject((OBJECT_TYPE)entry.second.type, entry.second.id, entry.second.player);
+				if (event.psSecond && event.psSecond->died)
+				{
+					event.psSecond = nullptr;
+				}
+				event.count = entry.count;
+				events.push_back(event);
+			}
+			batch.entries.clear();
+			batch.dedupIndex.clear();
+			if (events.empty())
+			{
+				continue;
+			}
+			switch (static_cast<BatchedEvent>(i))
+			{
+				case BatchedEvent::Attacked: instance->handle_eventAttackedBatch(events); break;
+				case BatchedEvent::ObjectSeen: instance->handle_eventObjectSeenBatch(events); break;
+				case BatchedEvent::COUNT: break;
+			}
+		}
+	}
+}
+
 //__ ## eventObjectTransfer(object, from)
 //__
 //__ An event that is run whenever an object is transferred between players,
@@ -2656,6 +2783,43 @@ int scripting_engine::groupSize(WZAPI_PARAMS(int groupId))
 	return groupMap->groupSize(groupId);
 }
 
+//-- ## setEventBatching(event, enabled[, dedup])
+//--
+//-- Switch a high-frequency event between being called once for every occurrence (the default) and
+//-- once per game tick with an array of all occurrences, which is much cheaper in large battles.
+//-- The event is either "eventAttacked" (then delivered as eventAttackedBatch) or "eventObjectSeen"
+//-- (then delivered as eventObjectSeenBatch). The optional third parameter coalesces occurrences:
+//-- ```DEDUP_NONE``` (default) keeps them all, ```DEDUP_VICTIM``` or ```DEDUP_ATTACKER``` keep one entry
+//-- per victim or per attacker, and ```DEDUP_VIEWER``` or ```DEDUP_SEEN``` keep one entry per viewer
+//-- or per seen object. The setting is not saved, so it must be made again after loading a game.
+//-- Returns true on success. (4.1+ only)
+//--
+bool scripting_engine::setEventBatching(WZAPI_PARAMS(std::string eventName, bool enabled, optional<int> dedup))
+{
+	BatchedEvent event = BatchedEvent::COUNT;
+	if (eventName == "eventAttacked")
+	{
+		event = BatchedEvent::Attacked;
+	}
+	else if (eventName == "eventObjectSeen")
+	{
+		event = BatchedEvent::ObjectSeen;
+	}
+	else
+	{
+		SCRIPT_ASSERT(false, context, false, "Event %s cannot be batched", eventName.c_str());
+	}
+	int dedupValue = dedup.value_or(EVENT_BATCH_DEDUP_NONE);
+	SCRIPT_ASSERT(false, context, dedupValue >= EVENT_BATCH_DEDUP_NONE && dedupValue <= EVENT_BATCH_DEDUP_SECOND, "Invalid dedup value %d", dedupValue);
+
+	EventBatch &batch = instance().eventBatches[context.currentInstance()][static_cast<size_t>(event)];
+	batch.enabled = enabled;
+	batch.dedup = static_cast<EVENT_BATCH_DEDUP>(dedupValue);
+	batch.entries.clear();
+	batch.dedupIndex.clear();
+	return true;
+}
+
 // ----------------------------------------------------------------------------------------
 // Register functions with scripting system
 
@@ -24,6 +24,7 @@
 #include "lib/netplay/netplay.h"
 #include "random.h"
 #include "wzapi.h"
+#include <array>
 #include <chrono>
 #include <memory>
 #include <unordered_set>
@@ -37,6 +38,7 @@ struct DROID_TEMPLATE;
 struct FEATURE;
 struct RESEARCH;
 struct STRUCTURE;
+class WzThreadPool;
 
 enum SCRIPT_TRIGGER_TYPE
 {
@@ -69,6 +71,14 @@ enum SCRIPT_TRIGGER_TYPE
 	TRIGGER_OBJECT_RECYCLED
 };
 
+/// How occurrences of a batched event are coalesced (see setEventBatching())
+enum EVENT_BATCH_DEDUP
+{
+	EVENT_BATCH_DEDUP_NONE,
+	EVENT_BATCH_DEDUP_FIRST, ///< one entry per victim / viewer
+	EVENT_BATCH_DEDUP_SECOND ///< one entry per attacker / seen object
+};
+
 enum SCRIPT_TYPE
 {
 	SCRIPT_POSITION = OBJ_NUM_TYPES,
@@ -110,6 +120,8 @@ wzapi::scripting_instance* loadPlayerScript(const WzString& path, int player, AI
 // but before triggering any events.
 bool loadScriptStates(const char *filename);
 bool saveScriptStates(const char *filename);
+/// Block until a script state file that is still being written in the background (see war_getBackgroundScriptStateSave()) is on disk
+void waitForScriptStateSave();
 
 /// Tell script system that an object has been removed.
 void scriptRemoveObject(const BASE_OBJECT *psObj);
@@ -331,6 +343,9 @@ private:
 	std::list<std::shared_ptr<timerNode>> timers;
 	uniqueTimerID lastTimerID = 0;
 	std::unordered_map<uniqueTimerID, std::list<std::shared_ptr<timerNode>>::iterator> timerIDMap; // a map from uniqueTimerID -> entry in the timers list
+
+	/// Writes script state files off the main thread (see war_getBackgroundScriptStateSave())
+	WzThreadPool *scriptStateWriter = nullptr;
 private:
 	scripting_engine() { }
 public:
@@ -348,6 +363,7 @@ public:
 	// but before triggering any events.
 	bool loadScriptStates(const char *filename);
 	bool saveScriptStates(const char *filename);
+	void waitForScriptStateSave();
 
 	bool unregisterFunctions(wzapi::scripting_instance *instance);
 	void prepareLabels();
@@ -415,6 +431,36 @@ private:
 public:
 	bool triggerEventSeen(BASE_OBJECT *psViewer, BASE_OBJECT *psSeen);
 
+// MARK: EVENT BATCHING
+public:
+	/// High-frequency events that scripts may opt to receive once per tick, as an array
+	enum class BatchedEvent
+	{
+		Attacked,
+		ObjectSeen,
+		COUNT
+	};
+	/// If `instance` has batching enabled for `event`, adds the occurrence to its batch and returns true
+	bool batchEvent(wzapi::scripting_instance *instance, BatchedEvent event, const BASE_OBJECT *psFirst, const BASE_OBJECT *psSecond);
+	/// Delivers (and clears) all pending event batches
+	void flushEventBatches();
+private:
+	struct EventBatch
+	{
+		struct Entry
+		{
+			wzapi::game_object_identifier first;
+			wzapi::game_object_identifier second;
+			int count;
+		};
+		bool enabled = false;
+		EVENT_BATCH_DEDUP dedup = EVENT_BATCH_DEDUP_NONE;
+		std::vector<Entry> entries;
+		std::unordered_map<uint32_t, size_t> dedupIndex; // object id -> index into entries
+	};
+	typedef std::array<EventBatch, static_cast<size_t>(BatchedEvent::COUNT)> InstanceEventBatches;
+	std::unordered_map<wzapi::scripting_instance *, InstanceEventBatches> eventBatches;
+
 // MARK: wzapi functions
 public:
 	// Used for retrieving information to set up script instance environments
@@ -472,6 +518,9 @@ public:
 	static wzapi::no_return_value groupAddDroid(WZAPI_PARAMS(int groupId, const DROID *psDroid));
 	static wzapi::no_return_value groupAdd(WZAPI_PARAMS(int groupId, const BASE_OBJECT *psObj));
 	static int groupSize(WZAPI_PARAMS(int groupId));
+
+	// Event batching
+	static bool setEventBatching(WZAPI_PARAMS(std::string eventName, bool enabled, optional<int> dedup));
 private:
 	wzapi::scripting_instance* findInstanceForPlayer(int match, const WzString& scriptName);
 
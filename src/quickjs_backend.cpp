@@ -72,9 +72,11 @@
 #include "wzapi.h"
 #include "qtscript.h"
 #include "featuredef.h"
+#include "version.h"
 
 
 #include <unordered_set>
+#include "lib/framework/crc.h"
 #include "lib/framework/file.h"
 #include <unordered_map>
 
@@ -94,6 +96,10 @@ MSVC_PRAGMA(warning( pop ))
 #include "3rdparty/gsl_finally.h"
 #include "3rdparty/integer_sequence.hpp"
 
+#if !defined(WZ_QUICKJS_VERSION)
+#define WZ_QUICKJS_VERSION "unknown"
+#endif
+
 // Alternatives for C++ - can't use the JS_CFUNC_DEF / JS_CGETSET_DEF / etc defines
 // #define JS_CFUNC_DEF(name, length, func1) { name, JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE, JS_DEF_CFUNC, 0, .u = { .func = { length, JS_CFUNC_generic, { .generic = func1 } } } }
 static inline JSCFunctionListEntry QJS_CFUNC_DEF(const char *name, uint8_t length, JSCFunction *func1)
@@ -480,6 +486,16 @@ public:
 	//__
 	virtual bool handle_eventAttacked(const BASE_OBJECT *psVictim, const BASE_OBJECT *psAttacker) override;
 
+	//__ ## eventAttackedBatch(attacks)
+	//__
+	//__ Replaces eventAttacked for scripts that called ```setEventBatching("eventAttacked", true)```.
+	//__ It is run at most once per game tick, with an array of all attacks since the last call.
+	//__ Each item has a ```victim```, an ```attacker``` and a ```count``` of the attacks it stands for
+	//__ (more than one if attacks were coalesced, see setEventBatching()). Attacks on objects that no longer
+	//__ exist are dropped, and ```attacker``` is null if it no longer exists. (4.1+ only)
+	//__
+	virtual bool handle_eventAttackedBatch(const std::vector<wzapi::batched_event>& attacks) override;
+
 	//__ ## eventResearched(research, structure, player)
 	//__
 	//__ An event that is run whenever a new research is available. The structure
@@ -513,6 +529,14 @@ public:
 	//__ object being seen.
 	virtual bool handle_eventObjectSeen(const BASE_OBJECT *psViewer, const BASE_OBJECT *psSeen) override;
 
+	//__
+	//__ ## eventObjectSeenBatch(sightings)
+	//__
+	//__ Replaces eventObjectSeen for scripts that called ```setEventBatching("eventObjectSeen", true)```.
+	//__ It is run at most once per game tick, with an array of items that each have a ```viewer```,
+	//__ a ```seen``` object and a ```count```, like eventAttackedBatch. (4.1+ only)
+	virtual bool handle_eventObjectSeenBatch(const std::vector<wzapi::batched_event>& sightings) override;
+
 	//__
 	//__ ## eventGroupSeen(viewer, group)
 	//__
@@ -1113,10 +1137,27 @@ JSValue convMax(const BASE_OBJECT *psObj, JSContext *ctx)
 	}
 }
 
+// An array of { <firstName>: object, <secondName>: object or null, count: number } for a batched event
+static JSValue convBatchedEvents(const std::vector<wzapi::batched_event>& events, const char *firstName, const char *secondName, JSContext *ctx)
+{
+	JSValue result = JS_NewArray(ctx);
+	uint32_t idx = 0;
+	for (const auto &event : events)
+	{
+		JSValue value = JS_NewObject(ctx);
+		QuickJS_DefinePropertyValue(ctx, value, firstName, convMax(event.psFirst, ctx), JS_PROP_ENUMERABLE);
+		QuickJS_DefinePropertyValue(ctx, value, secondName, convMax(event.psSecond, ctx), JS_PROP_ENUMERABLE);
+		QuickJS_DefinePropertyValue(ctx, value, "count", JS_NewInt32(ctx, event.count), JS_PROP_ENUMERABLE);
+		JS_DefinePropertyValueUint32(ctx, result, idx++, value, JS_PROP_C_W_E);
+	}
+	return result;
+}
+
 // Call a function by name
 static JSValue callFunction(JSContext *ctx, const std::string &function, std::vector<JSValue> &args, bool event = true)
 {
 	const auto instance = engineToInstanceMap.at(ctx);
+	instance->markGlobalsDirty();
 	JSValue global_obj = instance->Get_Global_Obj();
 	if (event)
 	{
@@ -1760,6 +1801,42 @@ static JSValue callFunction(JSContext *ctx, const std::string &function, std::ve
 			}
 		};
 
+		template<>
+		struct unbox<wzapi::object_filter>
+		{
+			wzapi::object_filter operator()(size_t& idx, JSContext *ctx, int argc, JSValueConst *argv, const char *function)
+			{
+				wzapi::object_filter result;
+				if (argc <= idx)
+					return result;
+				JSValue filterVal = argv[idx++];
+				UNBOX_SCRIPT_ASSERT(context, JS_IsObject(filterVal), "Filter must be an object");
+				if (!JS_IsObject(filterVal))
+				{
+					return result;
+				}
+				// every property is optional - only override the defaults for those that are present
+				auto readProperty = [ctx, filterVal](const char *prop, const std::function<void (JSValue&)>& handler) {
+					JSValue val = JS_GetPropertyStr(ctx, filterVal, prop);
+					if (!JS_IsUndefined(val) && !JS_IsNull(val))
+					{
+						handler(val);
+					}
+					JS_FreeValue(ctx, val);
+				};
+				readProperty("type", [&](JSValue& val) { result.type = JSValueToInt32(ctx, val); });
+				readProperty("player", [&](JSValue& val) { result.player = JSValueToInt32(ctx, val); });
+				readProperty("playerMask", [&](JSValue& val) { result.playerMask = JSValueToUint32(ctx, val); });
+				readProperty("droidType", [&](JSValue& val) { result.droidType = JSValueToInt32(ctx, val); });
+				readProperty("hasWeapon", [&](JSValue& val) { result.hasWeapon = (bool)JS_ToBool(ctx, val); });
+				readProperty("maxHealth", [&](JSValue& val) { result.maxHealth = JSValueToInt32(ctx, val); });
+				readProperty("seen", [&](JSValue& val) { result.seen = JS_ToBool(ctx, val); });
+				readProperty("sortByDistance", [&](JSValue& val) { result.sortByDistance = JS_ToBool(ctx, val); });
+				readProperty("limit", [&](JSValue& val) { result.limit = JSValueToUint32(ctx, val); });
+				return result;
+			}
+		};
+
 		template<typename T>
 		JSValue box(T a, JSContext *);
 
@@ -2278,6 +2355,53 @@ static std::string QuickJS_DumpError(JSContext *ctx)
 	return result;
 }
 
+// Compiles a script (without running it), using the bytecode cache in "cache/scripts/" when possible.
+// Cached bytecode is keyed by the QuickJS and game versions, the file name (which ends up in the
+// debug info) and the source itself, so stale entries are simply never looked up again (and pruned at startup).
+static JSValue QuickJS_CompileScript(JSContext *ctx, const char *source, size_t sourceLen, const std::string &fileName)
+{
+	std::string keyData = std::string(WZ_QUICKJS_VERSION) + '\0' + version_getVersionString() + '\0' + fileName + '\0';
+	keyData.append(source, sourceLen);
+	std::string cachePath = "cache/scripts/" + sha256Sum(keyData.data(), keyData.size()).toString() + ".qjsbc";
+
+	// QuickJS does not validate bytecode, so only entries this game wrote itself may be read (never ones in an archive)
+	if (isWriteDirFile(cachePath.c_str()))
+	{
+		char *bytecode = nullptr;
+		UDWORD bytecodeSize = 0;
+		if (loadFile(cachePath.c_str(), &bytecode, &bytecodeSize))
+		{
+			JSValue compiledObj = JS_ReadObject(ctx, reinterpret_cast<const uint8_t *>(bytecode), bytecodeSize, JS_READ_OBJ_BYTECODE);
+			free(bytecode);
+			if (!JS_IsException(compiledObj))
+			{
+				debug(LOG_SCRIPT, "Loaded %s from bytecode cache", fileName.c_str());
+				return compiledObj;
+			}
+			std::string errorAsString = QuickJS_DumpError(ctx);
+			debug(LOG_WARNING, "Discarding unreadable cached bytecode for %s: %s", fileName.c_str(), errorAsString.c_str());
+		}
+		PHYSFS_delete(cachePath.c_str());
+	}
+
+	JSValue compiledObj = JS_Eval(ctx, source, sourceLen, fileName.c_str(), JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+	if (JS_IsException(compiledObj))
+	{
+		return compiledObj;
+	}
+	size_t bytecodeSize = 0;
+	uint8_t *bytecode = JS_WriteObject(ctx, &bytecodeSize, compiledObj, JS_WRITE_OBJ_BYTECODE);
+	if (bytecode)
+	{
+		if (!saveFileAtomically(cachePath.c_str(), reinterpret_cast<const char *>(bytecode), static_cast<UDWORD>(bytecodeSize)))
+		{
+			debug(LOG_WARNING, "Failed to write bytecode cache for %s", fileName.c_str());
+		}
+		js_free(ctx, bytecode);
+	}
+	return compiledObj;
+}
+
 static bool strEndsWith(const std::string &str, const std::string &suffix)
 {
 	return (str.size() >= suffix.size()) && (str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0);
@@ -2303,7 +2427,7 @@ static JSValue js_include(JSContext *ctx, JSValueConst this_val, int argc, JSVal
 		JS_ThrowReferenceError(ctx, "Failed to read include file \"%s\"", filePath.c_str());
 		return JS_FALSE;
 	}
-	JSValue compiledFuncObj = JS_Eval(ctx, bytes, size, loadedFilePath.c_str(), JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+	JSValue compiledFuncObj = QuickJS_CompileScript(ctx, bytes, size, loadedFilePath);
 	free(bytes);
 	if (JS_IsException(compiledFuncObj))
 	{
@@ -2921,7 +3045,7 @@ bool quickjs_scripting_instance::loadScript(const WzString& path, int player, in
 		return false;
 	}
 	m_path = path.toUtf8();
-	compiledScriptObj = JS_Eval(ctx, bytes, size, path.toUtf8().c_str(), JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+	compiledScriptObj = QuickJS_CompileScript(ctx, bytes, size, m_path);
 	free(bytes);
 	if (JS_IsException(compiledScriptObj))
 	{
@@ -2952,6 +3076,7 @@ bool quickjs_scripting_instance::loadScript(const WzString& path, int player, in
 bool quickjs_scripting_instance::readyInstanceForExecution()
 {
 	ASSERT_OR_RETURN(false, !JS_IsUninitialized(compiledScriptObj), "compiledScriptObj is uninitialized");
+	markGlobalsDirty();
 	JSValue result = JS_EvalFunction(ctx, compiledScriptObj);
 	compiledScriptObj = JS_UNINITIALIZED;
 	if (JS_IsException(result))
@@ -2988,6 +3113,7 @@ bool quickjs_scripting_instance::saveScriptGlobals(nlohmann::json &result)
 bool quickjs_scripting_instance::loadScriptGlobals(const nlohmann::json &result)
 {
 	ASSERT_OR_RETURN(false, result.is_object(), "Can't load script globals from non-json-object");
+	markGlobalsDirty();
 	for (auto it : result.items())
 	{
 		// IMPORTANT: "null" JSON values *MUST* map to JS_UNDEFINED.
@@ -3097,6 +3223,7 @@ bool quickjs_scripting_instance::debugEvaluateCommand(const std::string &text)
 		compiledFuncObj = JS_UNINITIALIZED;
 		return false;
 	}
+	markGlobalsDirty();
 	JSValue result = JS_EvalFunction(ctx, compiledFuncObj);
 	compiledFuncObj = JS_UNINITIALIZED;
 	if (JS_IsException(result))
@@ -3134,6 +3261,7 @@ void quickjs_scripting_instance::setSpecifiedGlobalVariables(const nlohmann::jso
 		ASSERT(false, "setSpecifiedGlobalVariables expects a JSON object");
 		return;
 	}
+	markGlobalsDirty();
 	int propertyFlags = toQuickJSPropertyFlags(flags) | JS_PROP_ENUMERABLE;
 	bool markGlobalAsInternal = (flags & wzapi::GlobalVariableFlags::DoNotSave) == wzapi::GlobalVariableFlags::DoNotSave;
 	for (auto it : variables.items())
@@ -3150,6 +3278,7 @@ void quickjs_scripting_instance::setSpecifiedGlobalVariables(const nlohmann::jso
 void quickjs_scripting_instance::setSpecifiedGlobalVariable(const std::string& name, const nlohmann::json& value, wzapi::GlobalVariableFlags flags /*= wzapi::GlobalVariableFlags::ReadOnly | wzapi::GlobalVariableFlags::DoNotSave*/)
 {
 	ASSERT(!name.empty(), "Empty key");
+	markGlobalsDirty();
 	int propertyFlags = toQuickJSPropertyFlags(flags) | JS_PROP_ENUMERABLE;
 	bool markGlobalAsInternal = (flags & wzapi::GlobalVariableFlags::DoNotSave) == wzapi::GlobalVariableFlags::DoNotSave;
 	JS_DefinePropertyValueStr(ctx, global_obj, name.c_str(), mapJsonToQuickJSValue(ctx, value, propertyFlags), propertyFlags);
@@ -3162,6 +3291,7 @@ void quickjs_scripting_instance::setSpecifiedGlobalVariable(const std::string& n
 void quickjs_scripting_instance::doNotSaveGlobal(const std::string &global)
 {
 	internalNamespace.insert(global);
+	markGlobalsDirty();
 }
 
 
@@ -3209,10 +3339,26 @@ IMPL_EVENT_HANDLER(eventStructureBuilt, const STRUCTURE *, optional<const DROID
 IMPL_EVENT_HANDLER(eventStructureDemolish, const STRUCTURE *, optional<const DROID *>)
 IMPL_EVENT_HANDLER(eventStructureReady, const STRUCTURE *)
 IMPL_EVENT_HANDLER(eventAttacked, const BASE_OBJECT *, const BASE_OBJECT *)
+bool quickjs_scripting_instance::handle_eventAttackedBatch(const std::vector<wzapi::batched_event>& attacks)
+{
+	std::vector<JSValue> args;
+	args.push_back(convBatchedEvents(attacks, "victim", "attacker", ctx));
+	callFunction(ctx, "eventAttackedBatch", args);
+	std::for_each(args.begin(), args.end(), [this](JSValue& val) { JS_FreeValue(ctx, val); });
+	return true;
+}
 IMPL_EVENT_HANDLER(eventResearched, const wzapi::researchResult&, wzapi::event_nullable_ptr<const STRUCTURE>, int)
 IMPL_EVENT_HANDLER(eventDestroyed, const BASE_OBJECT *)
 IMPL_EVENT_HANDLER(eventPickup, const FEATURE *, const DROID *)
 IMPL_EVENT_HANDLER(eventObjectSeen, const BASE_OBJECT *, const BASE_OBJECT *)
+bool quickjs_scripting_instance::handle_eventObjectSeenBatch(const std::vector<wzapi::batched_event>& sightings)
+{
+	std::vector<JSValue> args;
+	args.push_back(convBatchedEvents(sightings, "viewer", "seen", ctx));
+	callFunction(ctx, "eventObjectSeenBatch", args);
+	std::for_each(args.begin(), args.end(), [this](JSValue& val) { JS_FreeValue(ctx, val); });
+	return true;
+}
 IMPL_EVENT_HANDLER(eventGroupSeen, const BASE_OBJECT *, int)
 IMPL_EVENT_HANDLER(eventObjectTransfer, const BASE_OBJECT *, int)
 IMPL_EVENT_HANDLER(eventChat, int, int, const char *)
@@ -3281,6 +3427,7 @@ IMPL_JS_FUNC(groupAddArea, scripting_engine::groupAddArea)
 IMPL_JS_FUNC(groupAddDroid, scripting_engine::groupAddDroid)
 IMPL_JS_FUNC(groupAdd, scripting_engine::groupAdd)
 IMPL_JS_FUNC(groupSize, scripting_engine::groupSize)
+IMPL_JS_FUNC(setEventBatching, scripting_engine::setEventBatching)
 
 IMPL_JS_FUNC(activateStructure, wzapi::activateStructure)
 IMPL_JS_FUNC(findResearch, wzapi::findResearch)
@@ -3382,6 +3529,8 @@ IMPL_JS_FUNC(getScrollLimits, wzapi::getScrollLimits)
 IMPL_JS_FUNC(loadLevel, wzapi::loadLevel)
 IMPL_JS_FUNC(autoSave, wzapi::autoSave)
 IMPL_JS_FUNC(enumRange, wzapi::enumRange)
+IMPL_JS_FUNC(enumRangeFiltered, wzapi::enumRangeFiltered)
+IMPL_JS_FUNC(enumDroidFiltered, wzapi::enumDroidFiltered)
 IMPL_JS_FUNC(enumArea, scripting_engine::enumAreaJS)
 IMPL_JS_FUNC(addBeacon, wzapi::addBeacon)
 
@@ -3618,6 +3767,7 @@ bool quickjs_scripting_instance::registerFunctions(const std::string& scriptName
 	JS_REGISTER_FUNC2(hackAssert, 2, 2 + MAX_JS_VARARGS); // WZAPI
 	JS_REGISTER_FUNC2(hackMarkTiles, 1, 4); // WZAPI
 	JS_REGISTER_FUNC2(receiveAllEvents, 0, 1); // WZAPI
+	JS_REGISTER_FUNC2(setEventBatching, 2, 3); // scripting_engine
 	JS_REGISTER_FUNC(hackDoNotSave, 1); // WZAPI
 	JS_REGISTER_FUNC(hackPlayIngameAudio, 0); // WZAPI
 	JS_REGISTER_FUNC(hackStopIngameAudio, 0); // WZAPI
@@ -3636,6 +3786,8 @@ bool quickjs_scripting_instance::registerFunctions(const std::string& scriptName
 	JS_REGISTER_FUNC(enumSelected, 0); // WZAPI
 	JS_REGISTER_FUNC(enumResearch, 0); // WZAPI
 	JS_REGISTER_FUNC2(enumRange, 3, 5); // WZAPI
+	JS_REGISTER_FUNC(enumRangeFiltered, 4); // WZAPI
+	JS_REGISTER_FUNC(enumDroidFiltered, 2); // WZAPI
 	JS_REGISTER_FUNC2(enumArea, 1, 6); // scripting_engine
 	JS_REGISTER_FUNC2(getResearch, 1, 2); // WZAPI
 	JS_REGISTER_FUNC(pursueResearch, 2); // WZAPI
@@ -19,8 +19,10 @@
 */
 #include "random.h"
 #include "lib/netplay/netplay.h"
+#include "lib/framework/crc.h"
 
 static MersenneTwister gamePseudorandomNumberGenerator;
+static uint32_t gameSeed = 42;
 
 MersenneTwister::MersenneTwister(uint32_t seed)
 	: offset(624)
@@ -53,6 +55,11 @@ uint32_t MersenneTwister::u32()
 	return ret;
 }
 
+uint32_t MersenneTwister::hash() const
+{
+	return hashU32(offset, state, 624);
+}
+
 void MersenneTwister::generate()
 {
 	offset = 0;
@@ -80,6 +87,17 @@ void MersenneTwister::generate()
 void gameSRand(uint32_t seed)
 {
 	gamePseudorandomNumberGenerator = MersenneTwister(seed);
+	gameSeed = seed;
+}
+
+uint32_t gameRandSeed()
+{
+	return gameSeed;
+}
+
+uint32_t gameRandHash()
+{
+	return gamePseudorandomNumberGenerator.hash();
 }
 
 uint32_t gameRandU32()
@@ -30,6 +30,7 @@ class MersenneTwister
 public:
 	MersenneTwister(uint32_t seed = 42);
 	uint32_t u32();  ///< Generates a random number in the interval [0...UINT32_MAX].
+	uint32_t hash() const;  ///< Hash of the whole state, for checking that all clients are still in sync.
 
 private:
 	void generate();  ///< Generates more random numbers.
@@ -41,6 +42,12 @@ private:
 /// Seeds the random number generator. The seed is sent over the network, such that all clients generate the same number sequence, without the number sequence being the same each game.
 void gameSRand(uint32_t seed);
 
+/// Returns the seed last given to gameSRand().
+uint32_t gameRandSeed();
+
+/// Hash of the pseudorandom number generator state, without advancing it.
+uint32_t gameRandHash();
+
 /// Generates a random number in the interval [0...UINT32_MAX].
 /// Must not be called from graphics routines, only for making game decisions.
 uint32_t gameRandU32();
@@ -25,6 +25,8 @@
  */
 #include <string.h>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "lib/framework/frame.h"
 #include "lib/netplay/netplay.h"
@@ -50,6 +52,11 @@
 // The stores for the research stats
 std::vector<RESEARCH> asResearch;
 
+// Indices into asResearch, built by loadResearch
+static std::unordered_map<WzString, size_t> researchIndexById;
+static std::vector<size_t> researchTopologicalOrder;               ///< Every topic comes after all of its pre-requisites.
+static std::vector<std::vector<uint64_t>> researchRequirementBits;  ///< Per topic, a bitset of every topic it requires, directly or not.
+
 //used for Callbacks to say which topic was last researched
 RESEARCH                *psCBLastResearch;
 STRUCTURE				*psCBLastResStructure;
@@ -87,6 +94,9 @@ bool researchInitVars()
 	psCBLastResStructure = nullptr;
 	CBResFacilityOwner = -1;
 	asResearch.clear();
+	researchIndexById.clear();
+	researchTopologicalOrder.clear();
+	researchRequirementBits.clear();
 
 	for (int i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -153,6 +163,56 @@ public:
 	}
 };
 
+static void addTopologicalOrder(size_t inc, std::vector<bool> &added)
+{
+	if (added[inc])
+	{
+		return;
+	}
+	added[inc] = true;
+	for (auto requirementIndex : asResearch[inc].pPRList)
+	{
+		addTopologicalOrder(requirementIndex, added);
+	}
+	researchTopologicalOrder.push_back(inc);
+}
+
+/// Must only be called once the pre-requisites are known to be free of cycles.
+static void buildResearchRequirements()
+{
+	size_t words = (asResearch.size() + 63) / 64;
+	std::vector<bool> added(asResearch.size(), false);
+	researchTopologicalOrder.clear();
+	researchTopologicalOrder.reserve(asResearch.size());
+	for (size_t inc = 0; inc < asResearch.size(); ++inc)
+	{
+		addTopologicalOrder(inc, added);
+	}
+
+	// Each topic requires its pre-requisites, and everything they require - which is already known, going in topological order.
+	researchRequirementBits.assign(asResearch.size(), std::vector<uint64_t>(words, 0));
+	for (size_t inc : researchTopologicalOrder)
+	{
+		std::vector<uint64_t> &bits = researchRequirementBits[inc];
+		for (auto requirementIndex : asResearch[inc].pPRList)
+		{
+			bits[requirementIndex / 64] |= uint64_t(1) << (requirementIndex % 64);
+			std::vector<uint64_t> const &requirementBits = researchRequirementBits[requirementIndex];
+			for (size_t word = 0; word < words; ++word)
+			{
+				bits[word] |= requirementBits[word];
+			}
+		}
+	}
+}
+
+/// Whether topic inc requires requirementIndex, directly or through its other pre-requisites.
+static bool researchRequires(size_t inc, size_t requirementIndex)
+{
+	ASSERT_OR_RETURN(false, inc < researchRequirementBits.size() && requirementIndex < asResearch.size(), "Invalid research index");
+	return (researchRequirementBits[inc][requirementIndex / 64] >> (requirementIndex % 64)) & 1;
+}
+
 /** Load the research stats */
 bool loadResearch(WzConfig &ini)
 {
@@ -384,6 +444,7 @@ bool loadResearch(WzConfig &ini)
 			}
 		}
 
+		researchIndexById[research.id] = asResearch.size();
 		asResearch.push_back(research);
 		ini.endGroup();
 	}
@@ -414,6 +475,8 @@ bool loadResearch(WzConfig &ini)
 		return false;
 	}
 
+	buildResearchRequirements();
+
 	return true;
 }
 
@@ -678,6 +741,9 @@ bool ResearchShutDown()
 void ResearchRelease()
 {
 	asResearch.clear();
+	researchIndexById.clear();
+	researchTopologicalOrder.clear();
+	researchRequirementBits.clear();
 	for (auto &i : asPlayerResList)
 	{
 		i.clear();
@@ -999,12 +1065,10 @@ SDWORD	mapIconToRID(UDWORD iconID)
 //return a pointer to a research topic based on the name
 RESEARCH *getResearch(const char *pName)
 {
-	for (auto &inc : asResearch)
+	auto it = researchIndexById.find(WzString::fromUtf8(pName));
+	if (it != researchIndexById.end())
 	{
-		if (inc.id.compare(pName) == 0)
-		{
-			return &inc;
-		}
+		return &asResearch[it->second];
 	}
 	debug(LOG_WARNING, "Unknown research - %s", pName);
 	return nullptr;
@@ -1071,12 +1135,8 @@ static void replaceComponent(COMPONENT_STATS *pNewComponent, COMPONENT_STATS *pO
 a duplicate*/
 static bool checkResearchName(RESEARCH *psResearch, UDWORD numStats)
 {
-	for (size_t inc = 0; inc < numStats; inc++)
-	{
-
-		ASSERT_OR_RETURN(false, asResearch[inc].id.compare(psResearch->id) != 0,
-		                 "Research name has already been used - %s", getStatsName(psResearch));
-	}
+	ASSERT_OR_RETURN(false, researchIndexById.find(psResearch->id) == researchIndexById.end(),
+	                 "Research name has already been used - %s", getStatsName(psResearch));
 	return true;
 }
 
@@ -1373,13 +1433,29 @@ static void RecursivelyDisableResearchByID(size_t index)
 		DisableResearch(&asPlayerResList[player][index]);
 	}
 
-	for (size_t inc = 0; inc < asResearch.size(); inc++)
+	// Everything that requires this topic goes with it, unless only reachable through topics that were already disabled.
+	// Going in topological order, every pre-requisite of a topic has been decided before the topic itself.
+	std::vector<bool> reached(asResearch.size(), false);
+	reached[index] = true;
+	for (size_t inc : researchTopologicalOrder)
 	{
-		for (size_t prereq = 0; prereq < asResearch[inc].pPRList.size(); prereq++)
+		if (!researchRequires(inc, index) || IsResearchDisabled(&asPlayerResList[0][inc]))
+		{
+			continue;
+		}
+		for (auto requirementIndex : asResearch[inc].pPRList)
+		{
+			if (reached[requirementIndex])
+			{
+				reached[inc] = true;
+				break;
+			}
+		}
+		if (reached[inc])
 		{
-			if (asResearch[inc].pPRList[prereq] == index)
+			for (int player = 0; player < MAX_PLAYERS; ++player)
 			{
-				RecursivelyDisableResearchByID(inc);
+				DisableResearch(&asPlayerResList[player][inc]);
 			}
 		}
 	}
@@ -0,0 +1,242 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2021  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/**
+ * @file statehash.cpp
+ * Per-subsystem game state hashes, for pinning down desynchs.
+ */
+
+#include "statehash.h"
+
+#include "lib/framework/crc.h"
+#include "lib/gamelib/gtime.h"
+
+#include "droid.h"
+#include "mission.h"
+#include "multiplay.h"
+#include "objmem.h"
+#include "power.h"
+#include "projectile.h"
+#include "random.h"
+#include "research.h"
+#include "structure.h"
+
+#include <chrono>
+
+#define STATE_HASH_INTERVAL 2000  ///< gameTime between state hashes.
+#define STATE_HASH_HISTORY  4     ///< Must cover the maximum latency, which is 1 second.
+
+struct StateHashes
+{
+	uint32_t time;
+	uint32_t hashes[STATE_HASH_COUNT];
+};
+
+static StateHashes stateHashHistory[STATE_HASH_HISTORY];
+static unsigned stateHashNext = 0;
+static unsigned stateHashLastMicroseconds = 0;
+static unsigned stateHashDesynched = 0;
+static std::vector<uint32_t> stateHashWords;  ///< Scratch buffer, kept between calls to avoid reallocating.
+
+static inline void addObject(BASE_OBJECT const *psObj)
+{
+	stateHashWords.push_back(psObj->id);
+	stateHashWords.push_back(psObj->player);
+	stateHashWords.push_back(psObj->pos.x);
+	stateHashWords.push_back(psObj->pos.y);
+	stateHashWords.push_back(psObj->pos.z);
+	stateHashWords.push_back(psObj->rot.direction);
+	stateHashWords.push_back(psObj->body);
+}
+
+static void addDroidList(DROID const *psList)
+{
+	for (DROID const *psDroid = psList; psDroid != nullptr; psDroid = psDroid->psNext)
+	{
+		addObject(psDroid);
+		stateHashWords.push_back(psDroid->order.type);
+		stateHashWords.push_back(psDroid->action);
+		stateHashWords.push_back(psDroid->experience);
+		stateHashWords.push_back(psDroid->secondaryOrder);
+	}
+}
+
+static void addStructureList(STRUCTURE const *psList)
+{
+	for (STRUCTURE const *psStruct = psList; psStruct != nullptr; psStruct = psStruct->psNext)
+	{
+		addObject(psStruct);
+		stateHashWords.push_back(psStruct->status);
+		stateHashWords.push_back(psStruct->currentBuildPts);
+	}
+}
+
+static uint32_t hashWords()
+{
+	uint32_t hash = hashU32(0, stateHashWords.data(), stateHashWords.size());
+	stateHashWords.clear();
+	return hash;
+}
+
+/// Packs each subsystem into 32-bit words, and hashes those in one go with hashU32, which vectorises well.
+static void computeStateHashes(uint32_t hashes[STATE_HASH_COUNT])
+{
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		addDroidList(apsDroidLists[player]);
+		addDroidList(mission.apsDroidLists[player]);
+	}
+	hashes[STATE_HASH_DROIDS] = hashWords();
+
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		addStructureList(apsStructLists[player]);
+		addStructureList(mission.apsStructLists[player]);
+	}
+	hashes[STATE_HASH_STRUCTURES] = hashWords();
+
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		int64_t power = getPrecisePower(player);
+		stateHashWords.push_back((uint32_t)(power >> 32));
+		stateHashWords.push_back((uint32_t)power);
+		stateHashWords.push_back(getQueuedPower(player));
+	}
+	hashes[STATE_HASH_POWER] = hashWords();
+
+	for (unsigned player = 0; player < MAX_PLAYERS; ++player)
+	{
+		for (PLAYER_RESEARCH const &research : asPlayerResList[player])
+		{
+			// The pending bits only exist on the client that asked for the research, so leave them out.
+			stateHashWords.push_back(research.currentPoints);
+			stateHashWords.push_back((research.ResearchStatus & RESBITS) | research.possible << 8);
+		}
+	}
+	hashes[STATE_HASH_RESEARCH] = hashWords();
+
+	for (PROJECTILE const *psProj = proj_GetFirst(); psProj != nullptr; psProj = proj_GetNext())
+	{
+		stateHashWords.push_back(psProj->player);
+		stateHashWords.push_back(psProj->state);
+		stateHashWords.push_back(psProj->pos.x);
+		stateHashWords.push_back(psProj->pos.y);
+		stateHashWords.push_back(psProj->pos.z);
+	}
+	hashes[STATE_HASH_PROJECTILES] = hashWords();
+
+	hashes[STATE_HASH_RNG] = gameRandHash();
+}
+
+void stateHashReset()
+{
+	for (StateHashes &entry : stateHashHistory)
+	{
+		entry.time = 0;
+	}
+	stateHashNext = 0;
+	stateHashLastMicroseconds = 0;
+	stateHashDesynched = 0;
+}
+
+void sendStateHashes()
+{
+	// Once per STATE_HASH_INTERVAL, even if loaded from a savegame where gameTime isn't a round number.
+	if (!bMultiPlayer || gameTime < GAME_TICKS_PER_UPDATE || gameTime / STATE_HASH_INTERVAL == (gameTime - GAME_TICKS_PER_UPDATE) / STATE_HASH_INTERVAL)
+	{
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	StateHashes &entry = stateHashHistory[stateHashNext];
+	entry.time = gameTime;
+	computeStateHashes(entry.hashes);
+	stateHashNext = (stateHashNext + 1) % STATE_HASH_HISTORY;
+	stateHashLastMicroseconds = (unsigned)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	uint32_t time = entry.time;
+	NETbeginEncode(NETgameQueue(selectedPlayer), GAME_STATE_HASH);
+	NETuint32_t(&time);
+	for (unsigned n = 0; n < STATE_HASH_COUNT; ++n)
+	{
+		NETuint32_t(&entry.hashes[n]);
+	}
+	NETend();
+}
+
+void recvStateHashes(NETQUEUE queue)
+{
+	StateHashes theirs;
+	theirs.time = 0;
+
+	NETbeginDecode(queue, GAME_STATE_HASH);
+	NETuint32_t(&theirs.time);
+	for (unsigned n = 0; n < STATE_HASH_COUNT; ++n)
+	{
+		NETuint32_t(&theirs.hashes[n]);
+	}
+	NETend();
+
+	StateHashes const *ours = nullptr;
+	for (StateHashes const &entry : stateHashHistory)
+	{
+		if (entry.time == theirs.time && entry.time != 0)
+		{
+			ours = &entry;
+		}
+	}
+	if (ours == nullptr)
+	{
+		debug(LOG_SYNC, "Player %u sent state hashes for gameTime %u, which is too old to check.", queue.index, theirs.time);
+		return;
+	}
+
+	for (unsigned n = 0; n < STATE_HASH_COUNT; ++n)
+	{
+		if (ours->hashes[n] != theirs.hashes[n] && (stateHashDesynched & 1 << n) == 0)
+		{
+			// Only report the first difference per subsystem, since once out of sync, it will stay out of sync.
+			stateHashDesynched |= 1 << n;
+			debug(LOG_ERROR, "Desynch: %s differ from player %u's at gameTime %u (0x%08X != 0x%08X).", stateHashSubsystemName(n), queue.index, theirs.time, ours->hashes[n], theirs.hashes[n]);
+		}
+	}
+}
+
+unsigned stateHashMicroseconds()
+{
+	return stateHashLastMicroseconds;
+}
+
+unsigned stateHashDesynchedSubsystems()
+{
+	return stateHashDesynched;
+}
+
+char const *stateHashSubsystemName(unsigned subsystem)
+{
+	switch (subsystem)
+	{
+	case STATE_HASH_DROIDS:      return "droids";
+	case STATE_HASH_STRUCTURES:  return "structures";
+	case STATE_HASH_POWER:       return "power";
+	case STATE_HASH_RESEARCH:    return "research";
+	case STATE_HASH_PROJECTILES: return "projectiles";
+	case STATE_HASH_RNG:         return "random numbers";
+	}
+	return "unknown";
+}
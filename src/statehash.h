@@ -0,0 +1,46 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2021  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __INCLUDED_SRC_STATEHASH_H__
+#define __INCLUDED_SRC_STATEHASH_H__
+
+#include "lib/framework/frame.h"
+#include "lib/netplay/netplay.h"
+
+// Per-subsystem hashes of the game state, exchanged every few seconds, so that a desynch shows up as
+// "structures differ at gameTime 123000" rather than just a syncDebug CRC mismatch.
+
+enum StateHashSubsystem
+{
+	STATE_HASH_DROIDS,
+	STATE_HASH_STRUCTURES,
+	STATE_HASH_POWER,
+	STATE_HASH_RESEARCH,
+	STATE_HASH_PROJECTILES,
+	STATE_HASH_RNG,
+	STATE_HASH_COUNT
+};
+
+void stateHashReset();                       ///< Forgets all hashes, at the start of a game.
+void sendStateHashes();                      ///< Hashes the game state and sends it to everyone, if it's time to. Call at the same point of each tick on all clients.
+void recvStateHashes(NETQUEUE queue);        ///< Compares another player's hashes with ours, reporting which subsystems differ.
+unsigned stateHashMicroseconds();            ///< How long hashing the game state took, the last time.
+unsigned stateHashDesynchedSubsystems();     ///< Bit mask of subsystems (1 << StateHashSubsystem) that have ever differed from another player's.
+char const *stateHashSubsystemName(unsigned subsystem);
+
+#endif // __INCLUDED_SRC_STATEHASH_H__
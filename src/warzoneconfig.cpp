@@ -64,6 +64,10 @@ struct WARZONE_GLOBALS
 	bool radarJump = false;
 	video_backend gfxBackend = video_backend::opengl; // the actual default value is determined in loadConfig()
 	JS_BACKEND jsBackend = (JS_BACKEND)0;
+	bool backgroundScriptStateSave = false;
+	bool recordReplays = false;
+	bool binarySaves = false;
+	int assetCacheMiB = 0;
 	bool autoAdjustDisplayScale = true;
 };
 
@@ -403,6 +407,46 @@ void war_setJSBackend(JS_BACKEND backend)
 	warGlobs.jsBackend = backend;
 }
 
+bool war_getBackgroundScriptStateSave()
+{
+	return warGlobs.backgroundScriptStateSave;
+}
+
+void war_setBackgroundScriptStateSave(bool enabled)
+{
+	warGlobs.backgroundScriptStateSave = enabled;
+}
+
+bool war_getRecordReplays()
+{
+	return warGlobs.recordReplays;
+}
+
+void war_setRecordReplays(bool enabled)
+{
+	warGlobs.recordReplays = enabled;
+}
+
+bool war_getBinarySaves()
+{
+	return warGlobs.binarySaves;
+}
+
+void war_setBinarySaves(bool enabled)
+{
+	warGlobs.binarySaves = enabled;
+}
+
+int war_getAssetCacheMiB()
+{
+	return warGlobs.assetCacheMiB;
+}
+
+void war_setAssetCacheMiB(int mebibytes)
+{
+	warGlobs.assetCacheMiB = std::max(mebibytes, 0);
+}
+
 bool war_getAutoAdjustDisplayScale()
 {
 	return warGlobs.autoAdjustDisplayScale;
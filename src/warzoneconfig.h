@@ -114,6 +114,14 @@ video_backend war_getGfxBackend();
 void war_setGfxBackend(video_backend backend);
 JS_BACKEND war_getJSBackend();
 void war_setJSBackend(JS_BACKEND backend);
+bool war_getBackgroundScriptStateSave();
+void war_setBackgroundScriptStateSave(bool enabled);
+bool war_getRecordReplays();
+void war_setRecordReplays(bool enabled);
+bool war_getBinarySaves();
+void war_setBinarySaves(bool enabled);
+int war_getAssetCacheMiB();
+void war_setAssetCacheMiB(int mebibytes);
 bool war_getAutoAdjustDisplayScale();
 void war_setAutoAdjustDisplayScale(bool autoAdjustDisplayScale);
 
@@ -201,6 +201,17 @@ void wzapi::scripting_instance::dumpScriptLog(const std::string &info, int me)
 	}
 }
 
+const nlohmann::json& wzapi::scripting_instance::snapshotScriptGlobals()
+{
+	if (m_globalsDirty)
+	{
+		m_globalsSnapshot = nlohmann::json::object();
+		saveScriptGlobals(m_globalsSnapshot);
+		m_globalsDirty = false;
+	}
+	return m_globalsSnapshot;
+}
+
 wzapi::execution_context::~execution_context()
 { }
 int wzapi::execution_context::player() const
@@ -660,7 +671,8 @@ bool wzapi::setRevealStatus(WZAPI_PARAMS(bool status))
 
 //-- ## autoSave()
 //--
-//-- Perform automatic save
+//-- Perform automatic save. Returns true if the save was started; it is written in the background,
+//-- and ```eventGameSaved``` only runs once it has been written (or writing it has failed).
 //--
 bool wzapi::autoSave(WZAPI_NO_PARAMS)
 {
@@ -1038,6 +1050,24 @@ std::vector<const STRUCTURE *> wzapi::enumStructOffWorld(WZAPI_PARAMS(optional<i
 	return _enumStruct_fromList(context, _player, _structureType, _looking, (mission.apsStructLists));
 }
 
+// hide some engine craziness
+static DROID_TYPE scriptDroidTypeAlias(DROID_TYPE droidType)
+{
+	switch (droidType)
+	{
+	case DROID_CONSTRUCT:
+		return DROID_CYBORG_CONSTRUCT;
+	case DROID_WEAPON:
+		return DROID_CYBORG_SUPER;
+	case DROID_REPAIR:
+		return DROID_CYBORG_REPAIR;
+	case DROID_CYBORG:
+		return DROID_CYBORG_SUPER;
+	default:
+		return droidType;
+	}
+}
+
 //-- ## enumDroid([player[, droid type[, looking player]]])
 //--
 //-- Returns an array of droid objects. If no parameters given, it will
@@ -1063,20 +1093,7 @@ std::vector<const DROID *> wzapi::enumDroid(WZAPI_PARAMS(optional<int> _player,
 		looking = _looking.value();
 	}
 
-	switch (droidType) // hide some engine craziness
-	{
-	case DROID_CONSTRUCT:
-		droidType2 = DROID_CYBORG_CONSTRUCT; break;
-	case DROID_WEAPON:
-		droidType2 = DROID_CYBORG_SUPER; break;
-	case DROID_REPAIR:
-		droidType2 = DROID_CYBORG_REPAIR; break;
-	case DROID_CYBORG:
-		droidType2 = DROID_CYBORG_SUPER; break;
-	default:
-		droidType2 = droidType;
-		break;
-	}
+	droidType2 = scriptDroidTypeAlias(droidType);
 	SCRIPT_ASSERT_PLAYER({}, context, player);
 	SCRIPT_ASSERT({}, context, looking < MAX_PLAYERS && looking >= -1, "Looking player index out of range: %d", looking);
 	for (DROID *psDroid = apsDroidLists[player]; psDroid; psDroid = psDroid->psNext)
@@ -1245,6 +1262,156 @@ std::vector<const BASE_OBJECT *> wzapi::enumRange(WZAPI_PARAMS(int _x, int _y, i
 	return list;
 }
 
+// Evaluates an object_filter against a single object on behalf of player
+static bool objectMatchesFilter(const BASE_OBJECT *psObj, const wzapi::object_filter &filter, int player)
+{
+	if (psObj->died || (filter.seen && !psObj->visible[player]))
+	{
+		return false;
+	}
+	if (filter.type >= 0 && psObj->type != filter.type)
+	{
+		return false;
+	}
+	if (filter.playerMask != 0)
+	{
+		if (psObj->player >= MAX_PLAYERS || (filter.playerMask & (1u << psObj->player)) == 0)
+		{
+			return false;
+		}
+	}
+	else if (!((filter.player >= 0 && psObj->player == filter.player) || filter.player == ALL_PLAYERS
+	           || (filter.player == ALLIES && psObj->type != OBJ_FEATURE && aiCheckAlliances(psObj->player, player))
+	           || (filter.player == ENEMIES && psObj->type != OBJ_FEATURE && !aiCheckAlliances(psObj->player, player))))
+	{
+		return false;
+	}
+
+	bool hasWeapon = false;
+	unsigned maxBody = 1;
+	switch (psObj->type)
+	{
+	case OBJ_DROID:
+		{
+			const DROID *psDroid = castDroid(psObj);
+			DROID_TYPE droidType = (DROID_TYPE)filter.droidType;
+			if (droidType != DROID_ANY && droidType != psDroid->droidType && scriptDroidTypeAlias(droidType) != psDroid->droidType)
+			{
+				return false;
+			}
+			hasWeapon = psDroid->numWeaps > 0;
+			maxBody = psDroid->originalBody;
+			break;
+		}
+	case OBJ_STRUCTURE:
+		{
+			const STRUCTURE *psStruct = castStructure(psObj);
+			hasWeapon = psStruct->numWeaps > 0;
+			maxBody = structureBody(psStruct);
+			break;
+		}
+	case OBJ_FEATURE:
+		maxBody = castFeature(psObj)->psStats->body;
+		break;
+	default:
+		break;
+	}
+	if (filter.droidType != DROID_ANY && psObj->type != OBJ_DROID)
+	{
+		return false;
+	}
+	if (filter.hasWeapon.has_value() && filter.hasWeapon.value() != hasWeapon)
+	{
+		return false;
+	}
+	if (filter.maxHealth.has_value() && (int64_t)psObj->body * 100 > (int64_t)filter.maxHealth.value() * MAX(1, maxBody))
+	{
+		return false;
+	}
+	return true;
+}
+
+//-- ## enumRangeFiltered(x, y, range, filter)
+//--
+//-- Returns an array of game objects within range of given position that pass the given filter object.
+//-- The filter is evaluated natively before any objects are handed to the script, which makes this
+//-- much faster than calling ```enumRange``` and filtering the result in script. All filter properties
+//-- are optional: ```type``` (DROID, STRUCTURE or FEATURE), ```player``` (a player index, ALL_PLAYERS,
+//-- ALLIES or ENEMIES), ```playerMask``` (a bitmask of player indices, overrides ```player```),
+//-- ```droidType``` (as for ```enumDroid```), ```hasWeapon``` (boolean), ```maxHealth``` (only objects
+//-- at or below this health percentage), ```seen``` (only visible objects, true by default),
+//-- ```sortByDistance``` (nearest objects first) and ```limit``` (maximum number of objects returned). (4.1+ only)
+//--
+std::vector<const BASE_OBJECT *> wzapi::enumRangeFiltered(WZAPI_PARAMS(int _x, int _y, int _range, object_filter filter))
+{
+	int player = context.player();
+	int x = world_coord(_x);
+	int y = world_coord(_y);
+	int range = world_coord(_range);
+	SCRIPT_ASSERT({}, context, filter.player < MAX_PLAYERS && filter.player >= ENEMIES, "Filter player index out of range: %d", filter.player);
+
+	static GridList gridList;  // static to avoid allocations. // WARNING: THREAD-SAFETY
+	gridList = gridStartIterate(x, y, range);
+	std::vector<const BASE_OBJECT *> list;
+	for (GridIterator gi = gridList.begin(); gi != gridList.end(); ++gi)
+	{
+		const BASE_OBJECT *psObj = *gi;
+		if (objectMatchesFilter(psObj, filter, player))
+		{
+			list.push_back(psObj);
+			if (!filter.sortByDistance && filter.limit > 0 && list.size() >= filter.limit)
+			{
+				break;
+			}
+		}
+	}
+	if (filter.sortByDistance)
+	{
+		const Vector2i centre(x, y);
+		auto nearer = [centre](const BASE_OBJECT *a, const BASE_OBJECT *b) {
+			int64_t distA = dot(a->pos.xy() - centre, a->pos.xy() - centre);
+			int64_t distB = dot(b->pos.xy() - centre, b->pos.xy() - centre);
+			return distA < distB || (distA == distB && a->id < b->id);
+		};
+		if (filter.limit > 0 && list.size() > filter.limit)
+		{
+			std::partial_sort(list.begin(), list.begin() + filter.limit, list.end(), nearer);
+			list.resize(filter.limit);
+		}
+		else
+		{
+			std::sort(list.begin(), list.end(), nearer);
+		}
+	}
+	return list;
+}
+
+//-- ## enumDroidFiltered(player, filter)
+//--
+//-- Returns an array of droid objects belonging to the given player that pass the given filter
+//-- object. The filter takes the same properties as for ```enumRangeFiltered```, except that
+//-- ```type``` and ```sortByDistance``` are ignored. Note that ```seen``` defaults to true, so pass
+//-- ```seen: false``` to also include droids not visible to the calling player. (4.1+ only)
+//--
+std::vector<const DROID *> wzapi::enumDroidFiltered(WZAPI_PARAMS(int player, object_filter filter))
+{
+	SCRIPT_ASSERT_PLAYER({}, context, player);
+	filter.type = OBJ_DROID;
+	std::vector<const DROID *> matches;
+	for (DROID *psDroid = apsDroidLists[player]; psDroid; psDroid = psDroid->psNext)
+	{
+		if (objectMatchesFilter(psDroid, filter, context.player()))
+		{
+			matches.push_back(psDroid);
+			if (filter.limit > 0 && matches.size() >= filter.limit)
+			{
+				break;
+			}
+		}
+	}
+	return matches;
+}
+
 //-- ## pursueResearch(lab, research)
 //--
 //-- Start researching the first available technology on the way to the given technology.
@@ -1342,7 +1509,7 @@ bool wzapi::pursueResearch(WZAPI_PARAMS(const STRUCTURE *psStruct, string_or_str
 
 //-- ## findResearch(research, [player])
 //--
-//-- Return list of research items remaining to be researched for the given research item. (3.2+ only)
+//-- Return list of research items remaining to be researched for the given research item, each listed once. (3.2+ only)
 //-- (Optional second argument 3.2.3+ only)
 //--
 wzapi::researchResults wzapi::findResearch(WZAPI_PARAMS(std::string resName, optional<int> _player))
@@ -1364,24 +1531,29 @@ wzapi::researchResults wzapi::findResearch(WZAPI_PARAMS(std::string resName, opt
 	debug(LOG_SCRIPT, "Find reqs for %s for player %d", resName.c_str(), player);
 	// Go down the requirements list for the desired tech
 	std::list<RESEARCH *> reslist;
+	std::vector<bool> visited(asResearch.size(), false);  // Pre-requisites shared by several topics are only walked once.
 	RESEARCH *cur = psTarget;
 	while (cur)
 	{
-		if (!(asPlayerResList[player][cur->index].ResearchStatus & RESEARCHED))
-		{
-			debug(LOG_SCRIPT, "Added research in %d's %s for %s", player, getID(cur), getID(psTarget));
-			result.resList.push_back(cur);
-		}
 		RESEARCH *prev = cur;
 		cur = nullptr;
-		if (!prev->pPRList.empty())
-		{
-			cur = &asResearch[prev->pPRList[0]]; // get first pre-req
-		}
-		for (int i = 1; i < prev->pPRList.size(); i++)
+		if (!visited[prev->index])
 		{
-			// push any other pre-reqs on the stack
-			reslist.push_back(&asResearch[prev->pPRList[i]]);
+			visited[prev->index] = true;
+			if (!(asPlayerResList[player][prev->index].ResearchStatus & RESEARCHED))
+			{
+				debug(LOG_SCRIPT, "Added research in %d's %s for %s", player, getID(prev), getID(psTarget));
+				result.resList.push_back(prev);
+			}
+			if (!prev->pPRList.empty())
+			{
+				cur = &asResearch[prev->pPRList[0]]; // get first pre-req
+			}
+			for (int i = 1; i < prev->pPRList.size(); i++)
+			{
+				// push any other pre-reqs on the stack
+				reslist.push_back(&asResearch[prev->pPRList[i]]);
+			}
 		}
 		if (!cur && !reslist.empty())
 		{
@@ -4402,6 +4574,11 @@ nlohmann::json wzapi::getUsefulConstants()
 	constants["RESEARCH_DATA"] = SCRIPT_RESEARCH;
 	constants["LZ_COMPROMISED_TIME"] = JS_LZ_COMPROMISED_TIME;
 	constants["OBJECT_FLAG_UNSELECTABLE"] = OBJECT_FLAG_UNSELECTABLE;
+	constants["DEDUP_NONE"] = EVENT_BATCH_DEDUP_NONE;
+	constants["DEDUP_VICTIM"] = EVENT_BATCH_DEDUP_FIRST;
+	constants["DEDUP_ATTACKER"] = EVENT_BATCH_DEDUP_SECOND;
+	constants["DEDUP_VIEWER"] = EVENT_BATCH_DEDUP_FIRST;
+	constants["DEDUP_SEEN"] = EVENT_BATCH_DEDUP_SECOND;
 	// the constants below are subject to change without notice...
 	constants["PROX_MSG"] = MSG_PROXIMITY;
 	constants["CAMP_MSG"] = MSG_CAMPAIGN;
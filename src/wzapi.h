@@ -144,6 +144,14 @@ namespace wzapi
 		}
 	};
 
+	// One entry of a batched event (see eventAttackedBatch / eventObjectSeenBatch)
+	struct batched_event
+	{
+		const BASE_OBJECT *psFirst = nullptr; // victim / viewer
+		const BASE_OBJECT *psSecond = nullptr; // attacker / seen object (null if it no longer exists)
+		int count = 1; // number of occurrences coalesced into this entry
+	};
+
 	class scripting_event_handling_interface
 	{
 	public:
@@ -391,6 +399,16 @@ namespace wzapi
 		//__
 		virtual bool handle_eventAttacked(const BASE_OBJECT *psVictim, const BASE_OBJECT *psAttacker) = 0;
 
+		//__ ## eventAttackedBatch(attacks)
+		//__
+		//__ Replaces eventAttacked for scripts that called ```setEventBatching("eventAttacked", true)```.
+		//__ It is run at most once per game tick, with an array of all attacks since the last call.
+		//__ Each item has a ```victim```, an ```attacker``` and a ```count``` of the attacks it stands for
+		//__ (more than one if attacks were coalesced, see setEventBatching()). Attacks on objects that no longer
+		//__ exist are dropped, and ```attacker``` is null if it no longer exists. (4.1+ only)
+		//__
+		virtual bool handle_eventAttackedBatch(const std::vector<batched_event>& attacks) = 0;
+
 		//__ ## eventResearched(research, structure, player)
 		//__
 		//__ An event that is run whenever a new research is available. The structure
@@ -424,6 +442,14 @@ namespace wzapi
 		//__ object being seen.
 		virtual bool handle_eventObjectSeen(const BASE_OBJECT *psViewer, const BASE_OBJECT *psSeen) = 0;
 
+		//__
+		//__ ## eventObjectSeenBatch(sightings)
+		//__
+		//__ Replaces eventObjectSeen for scripts that called ```setEventBatching("eventObjectSeen", true)```.
+		//__ It is run at most once per game tick, with an array of items that each have a ```viewer```,
+		//__ a ```seen``` object and a ```count```, like eventAttackedBatch. (4.1+ only)
+		virtual bool handle_eventObjectSeenBatch(const std::vector<batched_event>& sightings) = 0;
+
 		//__
 		//__ ## eventGroupSeen(viewer, group)
 		//__
@@ -603,6 +629,11 @@ namespace wzapi
 		virtual bool saveScriptGlobals(nlohmann::json &result) = 0;
 		virtual bool loadScriptGlobals(const nlohmann::json &result) = 0;
 
+		// the result of saveScriptGlobals(), re-using the last result if the globals have not been marked dirty since
+		// (backends must call markGlobalsDirty() whenever script code runs, or saved globals are changed from outside)
+		const nlohmann::json& snapshotScriptGlobals();
+		inline void markGlobalsDirty() { m_globalsDirty = true; }
+
 		virtual nlohmann::json saveTimerFunction(uniqueTimerID timerID, std::string timerName, const timerAdditionalData* additionalParam) = 0;
 
 		// recreates timer functions (and additional userdata) based on the information saved by the saveTimerFunction() method
@@ -649,6 +680,9 @@ namespace wzapi
 		std::string m_scriptName;
 		std::string m_scriptPath;
 		bool m_isReceivingAllEvents = false;
+		std::vector<std::function<void ()>> m_deferredCalls;
+		bool m_globalsDirty = true;
+		nlohmann::json m_globalsSnapshot;
 	};
 
 	class execution_context
@@ -783,6 +817,21 @@ namespace wzapi
 		std::string label;
 	};
 
+	// predicate descriptor for the native filtered enum functions
+	// - evaluated in C++ before any script objects are constructed
+	struct object_filter
+	{
+		int type = -1; // OBJECT_TYPE to match, or -1 for any type
+		int player = -1; // player index, ALL_PLAYERS (-1), ALLIES (-2) or ENEMIES (-3)
+		uint32_t playerMask = 0; // if non-zero, bitmask of player indices to match (takes precedence over player)
+		int droidType = DROID_ANY; // only droids of this type (with the same aliasing as enumDroid)
+		optional<bool> hasWeapon;
+		optional<int> maxHealth; // only objects at or below this health percentage
+		bool seen = true; // only objects visible to the calling player
+		bool sortByDistance = false; // nearest first (ties broken by object id)
+		uint32_t limit = 0; // maximum number of results, 0 for no limit
+	};
+
 	// retVals
 	struct no_return_value
 	{ };
@@ -986,6 +1035,8 @@ namespace wzapi
 	researchResult getResearch(WZAPI_PARAMS(std::string resName, optional<int> _player));
 	researchResults enumResearch(WZAPI_NO_PARAMS);
 	std::vector<const BASE_OBJECT *> enumRange(WZAPI_PARAMS(int x, int y, int range, optional<int> _filter, optional<bool> _seen));
+	std::vector<const BASE_OBJECT *> enumRangeFiltered(WZAPI_PARAMS(int x, int y, int range, object_filter filter));
+	std::vector<const DROID *> enumDroidFiltered(WZAPI_PARAMS(int player, object_filter filter));
 	bool pursueResearch(WZAPI_PARAMS(const STRUCTURE *psStruct, string_or_string_list research));
 	researchResults findResearch(WZAPI_PARAMS(std::string resName, optional<int> _player));
 	int32_t distBetweenTwoPoints(WZAPI_PARAMS(int32_t x1, int32_t y1, int32_t x2, int32_t y2));